@@ -0,0 +1,91 @@
+/*
+This file implements the combiner that finishes on the first t+1 partial decryptions
+(see async_combiner.h) and a small in-process simulation of slow and fast players.
+*/
+
+#include "async_combiner.h"
+#include "threshold.h"
+#include <chrono>
+#include <stdexcept>
+
+AsyncCombiner::AsyncCombiner(const ZZ& B, long t, long n, const Group& G, LagrangeCache* cache)
+    : B(B), t(t), n(n), G(G), cache(cache), answered(n > 0 ? n : 0, 0) {
+    if (t < 0 || n < t + 1) throw runtime_error("AsyncCombiner needs n >= t+1 players!");
+    future_S = promise_S.get_future().share();
+}
+
+bool AsyncCombiner::submit(long index, const ZZ& D) {
+    vector<long> idx;
+    vector<ZZ> values;
+    {
+        lock_guard<mutex> lock(m);
+        if (finished || index < 1 || index > n || answered[index - 1]) return false;
+
+        answered[index - 1] = 1;
+        indices.push_back(index);
+        partials.push_back(D);
+        if ((long)indices.size() < t + 1) return true;
+
+        // This is the (t+1)-th partial: the set is complete, the rest is done outside the lock
+        finished = true;
+        idx = indices;
+        values = partials;
+    }
+
+    try {
+        // Weights for exactly the players that answered first
+        vector<ZZ> weights = cache ? cache->weights(idx) : lagrange_weights_at_zero(idx, G);
+        promise_S.set_value(combine_partials_multiexp(values, weights, G));
+    } catch (...) {
+        promise_S.set_exception(current_exception());
+    }
+    return true;
+}
+
+void AsyncCombiner::player_failed(long index, const string& reason) {
+    {
+        lock_guard<mutex> lock(m);
+        if (finished || index < 1 || index > n || answered[index - 1]) return;
+
+        answered[index - 1] = 1;
+        failed++;
+        if (n - failed >= t + 1) return; // enough players can still answer
+
+        finished = true;
+    }
+
+    promise_S.set_exception(make_exception_ptr(runtime_error(
+        "Threshold decryption impossible: only " + to_string(n - failed) + " players left (need "
+        + to_string(t + 1) + "), last failure from player " + to_string(index) + ": " + reason)));
+}
+
+vector<long> AsyncCombiner::used_players() const {
+    lock_guard<mutex> lock(m);
+    if (!finished || (long)indices.size() < t + 1) return {};
+    return indices;
+}
+
+vector<thread> simulate_players(
+    AsyncCombiner& combiner,
+    const ZZ& B,
+    const vector<Share>& shares,
+    const vector<long>& latency_ms,
+    const Group& G
+) {
+    if (latency_ms.size() != shares.size())
+        throw runtime_error("Every simulated player needs a latency!");
+
+    vector<thread> players;
+    for (size_t i = 0; i < shares.size(); i++) {
+        players.emplace_back([&combiner, &B, &G, share = shares[i], delay = latency_ms[i]] {
+            this_thread::sleep_for(chrono::milliseconds(delay));
+            try {
+                combiner.submit(share.index, partial_decrypt(B, share.value, G));
+            } catch (const exception& e) {
+                combiner.player_failed(share.index, e.what());
+            }
+        });
+    }
+
+    return players;
+}
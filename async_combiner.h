@@ -0,0 +1,74 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <NTL/ZZ.h>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "group.h"
+#include "shamir.h"
+#include "lagrange.h"
+
+using namespace NTL;
+using namespace std;
+
+/*
+Combining partial decryptions as they arrive, instead of waiting for a fixed subset.
+
+Any of the n players may send its partial D_i = B^(a_i), from any thread, in any order.
+As soon as t+1 different players have answered, the Lagrange weights are computed for exactly
+those players, S is combined and the future returned by result() becomes ready.
+Partials arriving after that are ignored, so the decryption time is the time of the
+(t+1)-th fastest player, not of the slowest one.
+*/
+class AsyncCombiner {
+public:
+    // The Group (and the cache, if given) must outlive the combiner
+    AsyncCombiner(const ZZ& B, long t, long n, const Group& G, LagrangeCache* cache = nullptr);
+
+    AsyncCombiner(const AsyncCombiner&) = delete;
+    AsyncCombiner& operator=(const AsyncCombiner&) = delete;
+
+    // A player's partial decryption arrived. Returns true if it is one of the t+1 that are used
+    // (false if the result is already complete, or this player already answered).
+    // The call that completes the set also does the combine, on its own thread.
+    bool submit(long index, const ZZ& D);
+
+    // A player will not answer (crashed, timed out, sent garbage).
+    // If fewer than t+1 players can still answer, the result becomes an exception.
+    void player_failed(long index, const string& reason);
+
+    // S = B^a, ready as soon as t+1 partials arrived (get() throws if that became impossible)
+    shared_future<ZZ> result() const { return future_S; }
+
+    // Indices of the players whose partials were combined (empty until the result is ready)
+    vector<long> used_players() const;
+
+private:
+    ZZ B;
+    long t;
+    long n;
+    const Group& G;
+    LagrangeCache* cache;
+
+    mutable mutex m;
+    vector<char> answered;       // answered[i-1]: player i sent a partial or failed
+    vector<long> indices;        // players collected so far, in arrival order
+    vector<ZZ> partials;
+    long failed = 0;
+    bool finished = false;
+
+    promise<ZZ> promise_S;
+    shared_future<ZZ> future_S;
+};
+
+// Local stand-in for the players' network: every share holder runs on its own thread,
+// sleeps latency_ms[i] (its network / compute delay), computes D_i = B^(a_i) and submits it.
+// The threads are returned so the caller can wait for the result first and join them afterwards.
+vector<thread> simulate_players(
+    AsyncCombiner& combiner,
+    const ZZ& B,
+    const vector<Share>& shares,
+    const vector<long>& latency_ms,
+    const Group& G
+);
@@ -0,0 +1,92 @@
+/*
+This file decrypts a whole batch of hybrid ciphertexts with one committee.
+Everything that only depends on the committee (the Lagrange weights) is done
+once, and the per-ciphertext work is spread over all cores with the thread pool.
+*/
+
+#include "batch.h"
+#include "lagrange.h"
+#include "crypto.h"
+#include "metrics.h"
+#include "subgroup.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+vector<vector<unsigned char>> threshold_decrypt_batch(
+    const vector<Ciphertext>& ciphertexts,
+    const vector<Share>& subset,
+    const Group& G,
+    ThreadPool& pool
+) {
+    TE_TIME(T_BATCH_DECRYPT);
+    if (subset.empty()) throw runtime_error("Batch decryption needs at least one share!");
+
+    // Lagrange weights depend only on which players take part, so once per batch.
+    // The committee is fixed for the whole batch, so each share is pre-weighted here:
+    // B^(λ_i * a_i) for every player, then a plain product instead of a multi-exponentiation.
+    vector<long> idx;
+    for (auto& sh : subset) idx.push_back(sh.index);
+    vector<ZZ> weights = lagrange_weights_at_zero(idx, G);
+
+    vector<ZZ> weighted_shares;
+    for (size_t i = 0; i < subset.size(); i++)
+        weighted_shares.push_back(MulMod(weights[i], subset[i].value, G.q));
+
+    size_t n = ciphertexts.size();
+    vector<vector<unsigned char>> plaintexts(n);
+    vector<string> errors(n);
+
+    // Validation stage: every B must be in the subgroup of order q before the shares touch it.
+    // Big chunks, so the batched check (one exponentiation per round for the whole chunk)
+    // can pay off; the bad elements are only searched for when a chunk fails.
+    const size_t CHECK_CHUNK = 256;
+    pool.parallel_for((n + CHECK_CHUNK - 1) / CHECK_CHUNK, [&](size_t c) {
+        size_t first = c * CHECK_CHUNK, last = min(n, first + CHECK_CHUNK);
+        vector<ZZ> Bs;
+        for (size_t j = first; j < last; j++) Bs.push_back(ciphertexts[j].B);
+        for (size_t k : find_non_subgroup(Bs, G)) errors[first + k] = "B is not in the subgroup of order q";
+    });
+
+    for (size_t j = 0; j < n; j++) {
+        if (!errors[j].empty())
+            throw runtime_error("Batch decryption failed at ciphertext " + to_string(j) + ": " + errors[j]);
+    }
+
+    // Each task takes a chunk of ciphertexts, so one player's exponentiations for the
+    // whole chunk can run side by side in SIMD lanes (see partial_decrypt_many)
+    const size_t CHUNK = 16;
+    size_t chunks = (n + CHUNK - 1) / CHUNK;
+
+    pool.parallel_for(chunks, [&](size_t c) {
+        size_t first = c * CHUNK, last = min(n, first + CHUNK);
+        try {
+            vector<ZZ> Bs;
+            for (size_t j = first; j < last; j++) Bs.push_back(ciphertexts[j].B);
+
+            // S_j = product of the pre-weighted partial decryptions B_j^(λ_i * a_i) mod p
+            vector<ZZ> S = partial_decrypt_many(Bs, weighted_shares[0], G);
+            for (size_t i = 1; i < weighted_shares.size(); i++) {
+                vector<ZZ> D = partial_decrypt_many(Bs, weighted_shares[i], G);
+                for (size_t j = 0; j < Bs.size(); j++) S[j] = group_mul(G, S[j], D[j]);
+            }
+
+            for (size_t j = first; j < last; j++) {
+                try {
+                    plaintexts[j] = aes256gcm_decrypt(sha256_of_ZZ(S[j - first]), ciphertexts[j].aead);
+                } catch (const exception& e) {
+                    errors[j] = e.what(); // every task writes only its own slots
+                }
+            }
+        } catch (const exception& e) {
+            for (size_t j = first; j < last; j++) errors[j] = e.what();
+        }
+    });
+
+    for (size_t j = 0; j < n; j++) {
+        if (!errors[j].empty())
+            throw runtime_error("Batch decryption failed at ciphertext " + to_string(j) + ": " + errors[j]);
+    }
+
+    return plaintexts;
+}
@@ -0,0 +1,22 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <NTL/ZZ.h>
+#include <vector>
+#include "shamir.h"
+#include "threshold.h"
+#include "threadpool.h"
+
+using namespace NTL;
+using namespace std;
+
+// Threshold-decrypting many ciphertexts with the same set of players (t+1 shares).
+// The Lagrange weights are computed once for the whole batch, then every ciphertext
+// (partial decryptions, combine, SHA-256 key, AES-256-GCM) is processed on the pool.
+// Plaintexts are returned in the same order as the ciphertexts.
+// Throws if any ciphertext fails to decrypt (the error names the first failing index),
+// and before any share is used if some B is not in the subgroup of order q (see subgroup.h).
+vector<vector<unsigned char>> threshold_decrypt_batch(
+    const vector<Ciphertext>& ciphertexts,
+    const vector<Share>& subset,
+    const Group& G,
+    ThreadPool& pool
+);
@@ -0,0 +1,750 @@
+// ==============================
+// Threshold-ElGamal Benchmarks
+// ==============================
+//
+// Usage:  ./threshold_bench [--quick] [--json FILE] [--filter TEXT] [--metrics FILE]
+//
+//   --quick        smaller t/n sweep and shorter timing (for a fast check)
+//   --json FILE    where to write the machine-readable results (default bench.json)
+//   --filter TEXT  only run benchmarks whose name contains TEXT
+//   --metrics FILE also write the library's own counters and timers (Prometheus text format)
+//
+// Every benchmark reports ns/op, ops/sec and heap allocations per op,
+// and all results are written to the JSON file so releases can be compared.
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <NTL/ZZ.h>
+#include "params.h"
+#include "fixedbase.h"
+#include "multiexp.h"
+#include "threshold.h"
+#include "shamir.h"
+#include "crypto.h"
+#include "batch.h"
+#include "lagrange.h"
+#include "crypto_stream.h"
+#include "serialize.h"
+#include "proofs.h"
+#include "async_combiner.h"
+#include "envelope.h"
+#include "feldman.h"
+#include "registry.h"
+#include "simd_mont.h"
+#include "metrics.h"
+#include "encrypt.h"
+#include "subgroup.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace NTL;
+
+//--------------------------------------------------------
+//----------- Counting heap allocations ------------------
+//--------------------------------------------------------
+
+// NTL, GMP and OpenSSL allocate with malloc directly, so we count at the malloc level.
+// On glibc the benchmark binary provides malloc/realloc/calloc itself and forwards to glibc.
+static atomic<long> alloc_count{0};
+static atomic<long> alloc_bytes{0};
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t n);
+void* __libc_realloc(void* ptr, size_t n);
+void* __libc_calloc(size_t count, size_t n);
+void __libc_free(void* ptr);
+
+void* malloc(size_t n) noexcept {
+    alloc_count.fetch_add(1, memory_order_relaxed);
+    alloc_bytes.fetch_add((long)n, memory_order_relaxed);
+    return __libc_malloc(n);
+}
+
+void* realloc(void* ptr, size_t n) noexcept {
+    alloc_count.fetch_add(1, memory_order_relaxed);
+    alloc_bytes.fetch_add((long)n, memory_order_relaxed);
+    return __libc_realloc(ptr, n);
+}
+
+void* calloc(size_t count, size_t n) noexcept {
+    alloc_count.fetch_add(1, memory_order_relaxed);
+    alloc_bytes.fetch_add((long)(count * n), memory_order_relaxed);
+    return __libc_calloc(count, n);
+}
+
+void free(void* ptr) noexcept {
+    __libc_free(ptr);
+}
+}
+static const bool ALLOCS_COUNTED = true;
+#else
+static const bool ALLOCS_COUNTED = false; // allocations are reported as -1
+#endif
+
+//--------------------------------------------------------
+//----------- Timing harness -----------------------------
+//--------------------------------------------------------
+
+typedef vector<pair<string, string>> Params;
+
+struct BenchResult {
+    string name;
+    Params params;
+    long iterations = 0;      // number of operations measured
+    double ns_per_op = 0;
+    double ops_per_sec = 0;
+    double allocs_per_op = 0;
+    double alloc_bytes_per_op = 0;
+};
+
+static vector<BenchResult> results;
+static double min_time_ns = 3e8;  // keep repeating a benchmark for at least this long
+static string name_filter;
+
+// Returns the elapsed time since start in nanoseconds
+static double ns_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+static bool selected(const string& name) {
+    return name_filter.empty() || name.find(name_filter) != string::npos;
+}
+
+// Running body() repeatedly (at least once, until min_time_ns passed or max_calls reached).
+// One call of body performs items_per_call operations (for example a batch of ciphertexts).
+template<class F>
+static void run(const string& name, const Params& params, F body, long items_per_call = 1, long max_calls = 1000000) {
+    if (!selected(name)) return;
+
+    long calls = 0;
+    long allocs_before = alloc_count.load();
+    long bytes_before = alloc_bytes.load();
+    auto start = chrono::steady_clock::now();
+    double elapsed = 0;
+
+    do {
+        body();
+        calls++;
+        elapsed = ns_since(start);
+    } while (elapsed < min_time_ns && calls < max_calls);
+
+    BenchResult r;
+    r.name = name;
+    r.params = params;
+    r.iterations = calls * items_per_call;
+    r.ns_per_op = elapsed / r.iterations;
+    r.ops_per_sec = 1e9 / r.ns_per_op;
+    r.allocs_per_op = ALLOCS_COUNTED ? (double)(alloc_count.load() - allocs_before) / r.iterations : -1;
+    r.alloc_bytes_per_op = ALLOCS_COUNTED ? (double)(alloc_bytes.load() - bytes_before) / r.iterations : -1;
+    results.push_back(r);
+
+    string label;
+    for (auto& kv : params) label += " " + kv.first + "=" + kv.second;
+
+    cout << left << setw(32) << name << setw(42) << label << right << fixed
+         << setprecision(0) << setw(14) << r.ns_per_op << " ns/op"
+         << setprecision(1) << setw(14) << r.ops_per_sec << " ops/s"
+         << setprecision(1) << setw(10) << r.allocs_per_op << " allocs/op" << endl;
+}
+
+static void check(bool ok, const string& what) {
+    if (!ok) cout << "  MISMATCH: " << what << endl;
+}
+
+//--------------------------------------------------------
+//----------- Writing the JSON report --------------------
+//--------------------------------------------------------
+
+static string json_escape(const string& s) {
+    string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if ((unsigned char)c < 0x20) { char buf[8]; snprintf(buf, sizeof(buf), "\\u%04x", c); out += buf; }
+        else out += c;
+    }
+    return out;
+}
+
+static void write_json(const string& path, const Group& G) {
+    ofstream f(path);
+    if (!f) { cout << "Cannot write " << path << endl; return; }
+
+    f << "{\n";
+    f << "  \"format\": \"threshold-elgamal-bench\",\n";
+    f << "  \"version\": 1,\n";
+    f << "  \"p_bits\": " << NumBits(G.p) << ",\n";
+    f << "  \"q_bits\": " << NumBits(G.q) << ",\n";
+    f << "  \"backend\": \"" << (G.backend ? G.backend->name() : "ntl") << "\",\n";
+    f << "  \"hardware_threads\": " << thread::hardware_concurrency() << ",\n";
+    f << "  \"allocations_counted\": " << (ALLOCS_COUNTED ? "true" : "false") << ",\n";
+    f << "  \"results\": [\n";
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        f << "    {\"name\": \"" << json_escape(r.name) << "\", \"params\": {";
+        for (size_t j = 0; j < r.params.size(); j++) {
+            f << (j ? ", " : "") << "\"" << json_escape(r.params[j].first) << "\": \""
+              << json_escape(r.params[j].second) << "\"";
+        }
+        f << "}, \"iterations\": " << r.iterations
+          << setprecision(3) << fixed
+          << ", \"ns_per_op\": " << r.ns_per_op
+          << ", \"ops_per_sec\": " << r.ops_per_sec
+          << ", \"allocs_per_op\": " << r.allocs_per_op
+          << ", \"alloc_bytes_per_op\": " << r.alloc_bytes_per_op << "}"
+          << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+
+    f << "  ]\n}\n";
+    cout << endl << "Wrote " << results.size() << " results to " << path << endl;
+}
+
+//--------------------------------------------------------
+//----------- Pipeline stages ----------------------------
+//--------------------------------------------------------
+
+// The same pipeline on the prime-field group and on elliptic curves
+static void bench_groups(const Group& modp) {
+    vector<Group> groups = { modp, make_ec_group("P-256"), make_ec_group("P-384") };
+
+    for (const Group& G : groups) {
+        Params params = {{"group", group_name(G)}};
+
+        ZZ a = RandomBnd(G.q);
+        ZZ A = group_power_g(G, a);
+        auto shares = shamir_split(a, 2, 5, G);
+        vector<Share> subset = { shares[0], shares[2], shares[4] };
+        vector<long> idx = { 1, 3, 5 };
+        vector<ZZ> weights = lagrange_weights_at_zero(idx, G);
+
+        ZZ b = RandomBnd(G.q);
+        ZZ B = group_power_g(G, b);
+        vector<ZZ> partials;
+        for (auto& sh : subset) partials.push_back(partial_decrypt(B, sh.value, G));
+        check(combine_partials_multiexp(partials, weights, G) == group_power(G, A, b), "threshold decrypt on " + group_name(G));
+
+        run("group_power_g", params, [&] { group_power_g(G, b); });
+        run("group_partial_decrypt", params, [&] { partial_decrypt(B, shares[0].value, G); });
+        run("group_combine_t2", params, [&] { combine_partials_multiexp(partials, weights, G); });
+        run("group_encrypt_kem", params, [&] {
+            ZZ r = RandomBnd(G.q);
+            group_power_g(G, r);
+            sha256_of_ZZ(group_power(G, A, r));
+        });
+    }
+}
+
+// Setup, key generation, one partial decryption, KDF
+static void bench_setup(const Group& G) {
+    run("load_parameters", {{"g_window", to_string(DEFAULT_G_WINDOW)}}, [] { load_parameters(); }, 1, 20);
+
+    run("keygen", {}, [&] {
+        ZZ a = RandomBnd(G.q);
+        ZZ A = fixed_base_power(G.g_table, a);
+    });
+
+    ZZ B = fixed_base_power(G.g_table, RandomBnd(G.q));
+    ZZ ai = RandomBnd(G.q);
+    check(partial_decrypt(B, ai, G) == PowerMod(B, ai, G.p), "partial_decrypt");
+
+    run("partial_decrypt", {{"backend", G.backend ? G.backend->name() : "ntl"}}, [&] { partial_decrypt(B, ai, G); });
+    run("partial_decrypt", {{"backend", "ntl"}}, [&] { PowerMod(B, ai, G.p); });
+
+    ZZ S = RandomBnd(G.p);
+    run("sha256_of_ZZ", {}, [&] { sha256_of_ZZ(S); });
+}
+
+// Fixed-base g^e: table size / build time / speed tradeoff
+static void bench_fixed_base(const Group& G) {
+    ZZ e = RandomBnd(G.q);
+
+    run("g_power", {{"method", "PowerMod"}}, [&] { PowerMod(G.g, e, G.p); });
+
+    for (long w = 1; w <= 8; w++) {
+        FixedBase fb;
+        string window = to_string(w);
+        fixed_base_init(fb, G.g, G.p, NumBits(G.q), w);
+
+        run("fixed_base_init", {{"window", window}}, [&] { fixed_base_init(fb, G.g, G.p, NumBits(G.q), w); }, 1, 5);
+        check(fixed_base_power(fb, e) == PowerMod(G.g, e, G.p), "fixed_base_power window " + window);
+
+        run("g_power", {{"method", "fixed_base"}, {"window", window},
+                        {"table_kib", to_string(fixed_base_table_bytes(fb) / 1024)}},
+            [&] { fixed_base_power(fb, e); });
+    }
+}
+
+// Shamir split, Lagrange weights and combine for growing committees
+static void bench_committee(const Group& G, const vector<pair<long, long>>& sizes) {
+    for (auto& tn : sizes) {
+        long t = tn.first, n = tn.second, k = t + 1;
+        Params tn_params = {{"t", to_string(t)}, {"n", to_string(n)}};
+
+        ZZ a = RandomBnd(G.q);
+        run("shamir_split", tn_params, [&] { shamir_split(a, t, n, G); }, 1, 1000);
+
+        // Every other player takes part
+        vector<long> idx(k);
+        for (long j = 0; j < k; j++) idx[j] = 2 * j + 1;
+
+        check(lagrange_weights_at_zero(idx, G) == lagrange_weights_at_zero_reference(idx, G), "lagrange k=" + to_string(k));
+        LagrangeCache cache(G);
+        run("lagrange_weights_at_zero", tn_params, [&] { lagrange_weights_at_zero(idx, G); });
+        run("lagrange_weights_reference", tn_params, [&] { lagrange_weights_at_zero_reference(idx, G); }, 1, 200);
+        run("lagrange_weights_cached", tn_params, [&] { cache.weights(idx); });
+
+        vector<ZZ> partials(k), weights(k);
+        for (long i = 0; i < k; i++) {
+            partials[i] = RandomBnd(G.p);
+            weights[i] = RandomBnd(G.q);
+        }
+
+        ZZ expected = combine_partials(partials, weights, G);
+        check(combine_partials_multiexp(partials, weights, G) == expected, "combine k=" + to_string(k));
+        check(multi_power_straus(partials, weights, G.p) == expected, "straus k=" + to_string(k));
+        check(multi_power_pippenger(partials, weights, G.p) == expected, "pippenger k=" + to_string(k));
+
+        run("combine_partials", tn_params, [&] { combine_partials(partials, weights, G); }, 1, 50);
+        run("combine_partials_multiexp", tn_params, [&] { combine_partials_multiexp(partials, weights, G); }, 1, 200);
+        run("multi_power_straus", tn_params, [&] { multi_power_straus(partials, weights, G.p); }, 1, 200);
+        run("multi_power_pippenger", tn_params, [&] { multi_power_pippenger(partials, weights, G.p); }, 1, 200);
+
+        // Pre-weighted partials (players already applied λ_i): the combiner does k-1 MulMods
+        vector<Partial> tagged(k);
+        for (long i = 0; i < k; i++) tagged[i] = { idx[i], PARTIAL_WEIGHTED, partials[i], idx };
+        run("combine_partials_preweighted", tn_params, [&] { combine_partials(tagged, G); });
+    }
+}
+
+// Share generation for very large n: shamir_split vs forward differences (1 thread and all threads)
+static void bench_share_generation(const Group& G, const vector<long>& ns) {
+    unsigned hw = max(1u, thread::hardware_concurrency());
+    ThreadPool pool(hw);
+
+    for (long t : {2L, 10L, 100L}) {
+        ZZ a = RandomBnd(G.q);
+        vector<ZZ> f = shamir_random_polynomial(a, t, G);
+
+        // Checking the streamed shares against direct evaluation
+        vector<ZZ> streamed(3000);
+        shamir_split_stream(f, 3000, G, [&](long i, const ZZ& v) { streamed[i - 1] = v; }, &pool);
+        for (long i : {1L, 1024L, 1025L, 3000L}) {
+            ZZ y(0);
+            for (long j = t; j >= 0; j--) y = (y * i + f[j]) % G.q;
+            check(streamed[i - 1] == y, "shamir_split_stream t=" + to_string(t) + " i=" + to_string(i));
+        }
+
+        for (long n : ns) {
+            Params p1 = {{"t", to_string(t)}, {"n", to_string(n)}, {"threads", "1"}};
+            Params ph = {{"t", to_string(t)}, {"n", to_string(n)}, {"threads", to_string(hw)}};
+
+            if ((double)n * t <= 1e6)
+                run("shamir_split_per_share", p1, [&] { shamir_split(a, t, n, G); }, n, 5);
+
+            ZZ last;
+            auto sink = [&](long i, const ZZ& v) { if (i == n) last = v; };
+            run("shamir_split_stream_per_share", p1, [&] { shamir_split_stream(f, n, G, sink); }, n, 5);
+            if (hw > 1)
+                run("shamir_split_stream_per_share", ph, [&] { shamir_split_stream(f, n, G, sink, &pool); }, n, 5);
+        }
+    }
+}
+
+// One decryption round on one thread (weights, k partials, combine, key hash):
+// fresh temporaries every time vs a reused Workspace (look at allocs/op)
+static void bench_workspace(const Group& G) {
+    for (long k : {3L, 11L}) {
+        ZZ a = RandomBnd(G.q);
+        auto shares = shamir_split(a, k - 1, k, G);
+        vector<long> idx;
+        for (auto& sh : shares) idx.push_back(sh.index);
+        ZZ B = fixed_base_power(G.g_table, RandomBnd(G.q));
+
+        vector<unsigned char> key_alloc;
+        auto round_alloc = [&] {
+            vector<ZZ> w = lagrange_weights_at_zero(idx, G);
+            vector<ZZ> D;
+            for (auto& sh : shares) D.push_back(partial_decrypt(B, sh.value, G));
+            key_alloc = sha256_of_ZZ(combine_partials_multiexp(D, w, G));
+        };
+
+        Workspace ws(G);
+        vector<ZZ> w, D(k);
+        ZZ S;
+        unsigned char key[32];
+        auto round_ws = [&] {
+            lagrange_weights_at_zero(w, idx, G, ws);
+            for (long i = 0; i < k; i++) partial_decrypt(D[i], B, shares[i].value, G);
+            combine_partials_multiexp(S, D, w, G, ws);
+            sha256_of_ZZ(key, S, ws);
+        };
+
+        round_alloc();
+        round_ws();
+        check(vector<unsigned char>(key, key + 32) == key_alloc, "workspace round k=" + to_string(k));
+
+        run("decrypt_round", {{"k", to_string(k)}, {"workspace", "no"}}, round_alloc);
+        run("decrypt_round", {{"k", to_string(k)}, {"workspace", "yes"}}, round_ws);
+        ws.reset();
+    }
+}
+
+// One player's partial decryptions of a batch: one at a time vs side by side in SIMD lanes
+static void bench_partial_decrypt_many(const Group& G, long count) {
+    ZZ a = RandomBnd(G.q);
+    vector<ZZ> Bs(count);
+    for (auto& B : Bs) B = fixed_base_power(G.g_table, RandomBnd(G.q));
+
+    vector<string> kernels = lane_kernels_available();
+    kernels.insert(kernels.begin(), "scalar");
+
+    for (const string& k : kernels) {
+        vector<ZZ> D = partial_decrypt_many(Bs, a, G, k);
+        check(D.front() == partial_decrypt(Bs.front(), a, G) && D.back() == partial_decrypt(Bs.back(), a, G),
+              "partial_decrypt_many " + k);
+
+        run("partial_decrypt_many", {{"kernel", k}, {"batch", to_string(count)}},
+            [&] { partial_decrypt_many(Bs, a, G, k); }, count, 3);
+    }
+}
+
+// Checking that a batch of B values is in the subgroup: one exponentiation per B vs find_non_subgroup.
+// The second group is a copy that pretends (p-1)/(2q) has no factor below 2^16 (like a Lim-Lee prime),
+// only to time the batched path: for the real 4093-bit group (factor 2) exact checks are cheaper.
+static void bench_subgroup(const Group& G, long count) {
+    vector<ZZ> Bs;
+    for (long j = 0; j < count; j++) Bs.push_back(group_power_g(G, RandomBnd(G.q)));
+    Group large_factors = G;
+    large_factors.cofactor_prime = COFACTOR_SEARCH_LIMIT;
+    check(find_non_subgroup(Bs, G).empty() && find_non_subgroup(Bs, large_factors).empty(), "subgroup check");
+
+    Params params = {{"batch", to_string(count)}};
+    run("subgroup_check_each", params, [&] { for (auto& B : Bs) in_subgroup(B, G); }, count, 3);
+    for (const Group* H : vector<const Group*>{ &G, &large_factors }) {
+        run("find_non_subgroup", {{"batch", to_string(count)}, {"rounds", to_string(subgroup_batch_rounds(*H))}},
+            [&] { find_non_subgroup(Bs, *H); }, count, 3);
+    }
+}
+
+// Whole batch decryption (t = 2, n = 5) for growing thread counts
+static void bench_batch(const Group& G, long count) {
+    ZZ a = RandomBnd(G.q);
+    ZZ A = fixed_base_power(G.g_table, a);
+    auto shares = shamir_split(a, 2, 5, G);
+    vector<Share> subset = { shares[0], shares[2], shares[4] };
+
+    vector<unsigned char> msg(256, 'x');
+    vector<Ciphertext> cts(count);
+    for (auto& ct : cts) {
+        ZZ b = RandomBnd(G.q);
+        ct.B = fixed_base_power(G.g_table, b);
+        ct.aead = aes256gcm_encrypt(sha256_of_ZZ(PowerMod(A, b, G.p)), msg);
+    }
+
+    // 1, 2, 4, ... up to the number of hardware threads (and that number itself)
+    unsigned hw = max(1u, thread::hardware_concurrency());
+    vector<unsigned> thread_counts;
+    for (unsigned t = 1; t < hw; t *= 2) thread_counts.push_back(t);
+    thread_counts.push_back(hw);
+
+    for (unsigned threads : thread_counts) {
+        ThreadPool pool(threads);
+        check(threshold_decrypt_batch(cts, subset, G, pool).back() == msg, "batch decrypt");
+
+        run("threshold_decrypt_batch", {{"t", "2"}, {"threads", to_string(threads)}, {"batch", to_string(count)}},
+            [&] { threshold_decrypt_batch(cts, subset, G, pool); }, count, 3);
+    }
+}
+
+// AES-256-GCM at several payload sizes: per-call API, session, streaming
+static void bench_aead() {
+    vector<unsigned char> key(32, 0x42);
+    AeadSession session(key);
+
+    for (size_t size : {64, 256, 1024, 16 * 1024, 1024 * 1024}) {
+        vector<unsigned char> msg(size, 0x61);
+        vector<unsigned char> blob = aes256gcm_encrypt(key, msg);
+        vector<unsigned char> sealed(size + AeadSession::OVERHEAD), opened(size);
+        Params bytes = {{"bytes", to_string(size)}};
+
+        run("aes256gcm_encrypt", bytes, [&] { aes256gcm_encrypt(key, msg); });
+        run("aes256gcm_decrypt", bytes, [&] { aes256gcm_decrypt(key, blob); });
+        run("aead_session_seal", bytes, [&] { session.seal(msg.data(), msg.size(), sealed.data()); });
+
+        size_t n = session.seal(msg.data(), msg.size(), sealed.data());
+        run("aead_session_open", bytes, [&] { session.open(sealed.data(), n, opened.data()); });
+        session.open(sealed.data(), n, opened.data());
+        check(opened == msg, "AeadSession round trip");
+    }
+
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull < 0) return;
+
+    vector<unsigned char> big(64 << 20, 0x61);
+    for (size_t chunk : {16 * 1024, 64 * 1024, 1024 * 1024}) {
+        run("aes256gcm_encrypt_region", {{"bytes", to_string(big.size())}, {"chunk", to_string(chunk)}},
+            [&] { aes256gcm_encrypt_region(key, big.data(), big.size(), devnull, chunk); }, 1, 5);
+    }
+    close(devnull);
+}
+
+// What the built-in instrumentation costs on a hot path (both are ~0 with make METRICS=0).
+// Runs first and clears the counters afterwards, so --metrics only shows the real work.
+static void bench_metrics() {
+    run("metrics_count", {}, [] { TE_COUNT(M_MODEXP, 1); });
+    run("metrics_timer_scope", {}, [] { TE_TIME(T_COMBINE); });
+    metrics_reset();
+}
+
+// Proofs of correct partial decryption: one by one vs one batch check
+static void bench_proofs(const Group& G, long count) {
+    for (long t : {2L, 10L}) {
+        long k = t + 1;
+        ZZ a = RandomBnd(G.q);
+        vector<ZZ> vkeys;
+        auto shares = shamir_split(a, t, k, G, vkeys);
+
+        vector<ZZ> Bs(count);
+        vector<vector<VerifiablePartial>> partials(count);
+        for (long j = 0; j < count; j++) {
+            Bs[j] = fixed_base_power(G.g_table, RandomBnd(G.q));
+            for (auto& sh : shares)
+                partials[j].push_back(partial_decrypt_with_proof(Bs[j], sh, vkeys[sh.index - 1], G));
+        }
+        check(verify_partials_batch(Bs, partials, vkeys, G), "verify_partials_batch t=" + to_string(t));
+        check(verify_partial(Bs[0], partials[0][0], vkeys[0], G), "verify_partial t=" + to_string(t));
+
+        Params params = {{"t", to_string(t)}, {"batch", to_string(count)}};
+        long proofs = k * count;
+        run("partial_decrypt_with_proof", params,
+            [&] { partial_decrypt_with_proof(Bs[0], shares[0], vkeys[0], G); });
+        run("verify_partial_each", params, [&] {
+            for (long j = 0; j < count; j++)
+                for (auto& d : partials[j]) verify_partial(Bs[j], d, vkeys[d.index - 1], G);
+        }, proofs, 3);
+        run("verify_partials_batch", params, [&] { verify_partials_batch(Bs, partials, vkeys, G); }, proofs, 5);
+    }
+}
+
+// Feldman share verification for a committee: every share on its own vs one batch check
+static void bench_feldman(const Group& G, const vector<long>& ns) {
+    ThreadPool pool(max(1u, thread::hardware_concurrency()));
+
+    for (long n : ns) {
+        long t = n / 2;
+        Params params = {{"t", to_string(t)}, {"n", to_string(n)}};
+
+        vector<ZZ> C;
+        vector<Share> shares = feldman_split(RandomBnd(G.q), t, n, G, C, &pool);
+        check(feldman_verify_shares_batch(shares, C, G), "feldman batch n=" + to_string(n));
+        check(feldman_verify_share(shares[n - 1], C, G), "feldman share n=" + to_string(n));
+
+        run("feldman_split", params, [&] { vector<ZZ> c; feldman_split(RandomBnd(G.q), t, n, G, c, &pool); }, 1, 1);
+        run("feldman_check_commitments", params, [&] { feldman_check_commitments(C, G); }, 1, 1);
+        run("feldman_verify_share", params, [&] { feldman_verify_share(shares[n - 1], C, G); });
+        run("feldman_verify_shares_batch", params, [&] { feldman_verify_shares_batch(shares, C, G); }, n, 1);
+    }
+}
+
+// Simulated players with one straggler: combining the first t+1 answers vs waiting for everyone
+static void bench_async(const Group& G) {
+    long t = 3, n = 10;
+    ZZ a = RandomBnd(G.q);
+    auto shares = shamir_split(a, t, n, G);
+    ZZ B = group_power_g(G, RandomBnd(G.q));
+    ZZ expected = group_power(G, B, a);
+
+    // Players answer after 5, 10, ..., 45 ms, and the last one after 250 ms
+    vector<long> latency_ms;
+    for (long i = 1; i < n; i++) latency_ms.push_back(5 * i);
+    latency_ms.push_back(250);
+
+    Params params = {{"t", to_string(t)}, {"n", to_string(n)}, {"slowest_ms", "250"}};
+    bool ok = true;
+
+    // The late players keep running after a timed call returns, so their combiners and threads are kept until the end
+    vector<unique_ptr<AsyncCombiner>> combiners;
+    vector<thread> stragglers;
+
+    run("async_combine_first_t_plus_1", params, [&] {
+        combiners.emplace_back(new AsyncCombiner(B, t, n, G));
+        vector<thread> players = simulate_players(*combiners.back(), B, shares, latency_ms, G);
+        ok = ok && combiners.back()->result().get() == expected;
+        for (auto& th : players) stragglers.push_back(move(th));
+    }, 1, 5);
+    for (auto& th : stragglers) th.join();
+
+    run("combine_after_all_players", params, [&] {
+        AsyncCombiner combiner(B, t, n, G);
+        vector<thread> players = simulate_players(combiner, B, shares, latency_ms, G);
+        for (auto& th : players) th.join();
+        ok = ok && combiner.result().get() == expected;
+    }, 1, 5);
+
+    check(ok, "async combine");
+}
+
+// Sender side: one-off encryption vs an Encryptor that has a table for the (repeat) public key,
+// and one multi-recipient encryption vs one encryption per recipient
+static void bench_encrypt(const Group& G, long recipients) {
+    vector<ZZ> As;
+    for (long i = 0; i < recipients; i++) As.push_back(group_power_g(G, RandomBnd(G.q)));
+    vector<unsigned char> msg(256, 'x');
+
+    Encryptor sender(G);
+    for (auto& A : As) sender.encrypt(A, msg), sender.encrypt(A, msg); // every key is hot now
+    check(sender.tables() == As.size(), "encryptor tables");
+
+    run("encrypt", {{"cache", "no"}}, [&] { encrypt(As[0], msg, G); }, 1, 200);
+    run("encrypt", {{"cache", "yes"}}, [&] { sender.encrypt(As[0], msg); }, 1, 200);
+
+    Params params = {{"recipients", to_string(recipients)}};
+    run("encrypt_each_recipient", params, [&] { for (auto& A : As) encrypt(A, msg, G); }, recipients, 20);
+    run("encrypt_multi", params, [&] { sender.encrypt_multi(As, msg); }, recipients, 20);
+}
+
+// Batch envelope: cost per record once the batch's single threshold decryption is done
+static void bench_envelope(const Group& G) {
+    ZZ a = RandomBnd(G.q);
+    ZZ A = group_power_g(G, a);
+    auto shares = shamir_split(a, 2, 5, G);
+    vector<Share> subset = { shares[0], shares[2], shares[4] };
+    vector<ZZ> weights = lagrange_weights_at_zero({ 1, 3, 5 }, G);
+
+    vector<vector<unsigned char>> messages(1000, vector<unsigned char>(256, 'x'));
+    BatchEnvelope env = batch_encrypt(A, messages, G);
+
+    // The committee's work: one round for the whole batch (or, without envelopes, one round per message)
+    auto committee_round = [&] {
+        vector<ZZ> partials;
+        for (auto& sh : subset) partials.push_back(partial_decrypt(env.B, sh.value, G));
+        return combine_partials_multiexp(partials, weights, G);
+    };
+    BatchKey key(committee_round(), env.B, G);
+    check(batch_open_record(key, env, 999) == messages[999], "batch envelope");
+
+    Params params = {{"bytes", "256"}};
+    run("batch_envelope_committee_round", {}, [&] { committee_round(); }, 1, 50);
+    run("batch_envelope_seal_record", params, [&] { key.seal(7, messages[7]); });
+    run("batch_envelope_open_record", params, [&] { batch_open_record(key, env, 7); });
+}
+
+// Worker startup: building the group from scratch (validation, table of g) vs loading a group cache
+static void bench_startup(const Group& G) {
+    string path = "bench_group.cache";
+    write_group_cache(path, G);
+
+    Group loaded = read_group_cache(path);
+    ZZ e = RandomBnd(G.q);
+    check(loaded.g_table.table == G.g_table.table && fixed_base_power(loaded.g_table, e) == fixed_base_power(G.g_table, e),
+          "group cache round trip");
+
+    ParameterSet ps;
+    ps.name = "modp";
+    ps.p = G.p;
+    ps.q = G.q;
+    ps.g = G.g;
+
+    run("startup", {{"from", "validate+build"}}, [&] { validate_parameter_set(ps); make_group(ps.p, ps.q, ps.g); }, 1, 3);
+    run("startup", {{"from", "build"}}, [&] { make_group(ps.p, ps.q, ps.g); }, 1, 20);
+    run("startup", {{"from", "group_cache"}}, [&] { read_group_cache(path); }, 1, 100);
+
+    unlink(path.c_str());
+}
+
+// Cold start of a share store: mmap + view vs parsing every share into a ZZ
+static void bench_store_load(const Group& G, long n) {
+    string path = "bench_shares.bin";
+    {
+        ShareStoreWriter w(path, n, G);
+        ZZ v = RandomBnd(G.q);
+        for (long i = 0; i < n; i++) w.put(i, i + 1, v + i);
+        w.close();
+    }
+
+    {
+        MappedFile f(path);
+        ShareStoreView view(f.data(), f.size());
+        Share last = view.share(n - 1);
+        check(view.size() == (size_t)n && last.index == n, "share store round trip");
+    }
+
+    Params params = {{"n", to_string(n)}};
+    run("share_store_mmap_open", params, [&] {
+        MappedFile f(path);
+        ShareStoreView view(f.data(), f.size());
+    }, 1, 1000);
+    run("share_store_parse_all", params, [&] {
+        MappedFile f(path);
+        ShareStoreView view(f.data(), f.size());
+        vector<Share> all(view.size());
+        for (size_t i = 0; i < view.size(); i++) all[i] = view.share(i);
+    }, n, 5);
+
+    unlink(path.c_str());
+}
+
+int main(int argc, char** argv) {
+    string json_path = "bench.json";
+    string metrics_path;
+    bool quick = false;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--quick") quick = true;
+        else if (arg == "--json" && i + 1 < argc) json_path = argv[++i];
+        else if (arg == "--filter" && i + 1 < argc) name_filter = argv[++i];
+        else if (arg == "--metrics" && i + 1 < argc) metrics_path = argv[++i];
+        else {
+            cout << "Usage: " << argv[0] << " [--quick] [--json FILE] [--filter TEXT] [--metrics FILE]" << endl;
+            return 1;
+        }
+    }
+
+    if (quick) min_time_ns = 5e7;
+
+    Group G = load_parameters();
+    cout << "p: " << NumBits(G.p) << " bits, q: " << NumBits(G.q) << " bits, backend: "
+         << (G.backend ? G.backend->name() : "ntl") << endl << endl;
+
+    vector<pair<long, long>> sizes = {{2, 5}, {5, 15}, {10, 30}};
+    if (!quick) {
+        sizes.push_back({25, 75});
+        sizes.push_back({50, 150});
+        sizes.push_back({100, 300});
+    }
+
+    bench_metrics();
+    bench_setup(G);
+    bench_groups(G);
+    bench_fixed_base(G);
+    bench_committee(G, sizes);
+    bench_share_generation(G, quick ? vector<long>{1000, 10000} : vector<long>{1000, 100000, 1000000});
+    bench_workspace(G);
+    bench_partial_decrypt_many(G, quick ? 16 : 64);
+    bench_subgroup(G, quick ? 64 : 256);
+    bench_batch(G, quick ? 8 : 32);
+    bench_async(G);
+    bench_proofs(G, quick ? 4 : 32);
+    bench_feldman(G, quick ? vector<long>{100} : vector<long>{100, 1000});
+    bench_aead();
+    bench_encrypt(G, quick ? 4 : 16);
+    bench_envelope(G);
+    bench_startup(G);
+    bench_store_load(G, quick ? 10000 : 1000000);
+
+    write_json(json_path, G);
+    if (!metrics_path.empty()) metrics_write_file(metrics_path, METRICS_PROMETHEUS);
+
+    return 0;
+}
@@ -5,11 +5,15 @@
 */
 
 #include "crypto.h"
+#include "metrics.h"
 #include <openssl/sha.h>  // This header gives us SHA-256 functions (hashing)
 #include <openssl/evp.h>  // This header gives us OpenSSL’s “EVP” interface
 #include <openssl/rand.h> // This header provides access to OpenSSL’s CSPRNG
 						  // CSPRNG stands for Cryptographically Secure Pseudo-Random Number Generator
+#include <openssl/crypto.h> // OPENSSL_cleanse
 #include <stdexcept>      // This is used for exception handling
+#include <climits>        // INT_MAX
+#include <cstring>        // memcpy
 
 /*
 Cryptographic hash and AES functions operate on bytes, not on big integers.
@@ -43,6 +47,21 @@ vector<unsigned char> sha256_of_ZZ(const ZZ& x) {
 													 // and store the 32-byte result in digest
     return digest; // returns 32 bytes
 }
+
+void sha256_of_ZZ(unsigned char digest[32], const ZZ& x, Workspace& ws) {
+    long n = NumBytes(x);
+    if (n == 0) n = 1; // same encoding as zz_to_bytes
+
+    unsigned char* data = ws.bytes(n);
+    BytesFromZZ(data, x, n);
+
+    EVP_MD_CTX* ctx = ws.sha256_ctx();
+    bool ok = EVP_DigestInit_ex2(ctx, ws.sha256(), nullptr) == 1
+           && EVP_DigestUpdate(ctx, data, n) == 1
+           && EVP_DigestFinal_ex(ctx, digest, nullptr) == 1;
+    OPENSSL_cleanse(data, n); // x is usually the shared secret S
+    if (!ok) throw runtime_error("SHA-256 failed!!");
+}
 //******************************************************
 //****************** Hashing ends **********************
 //******************************************************
@@ -57,6 +76,8 @@ vector<unsigned char> aes256gcm_encrypt(  //Encrypt a message using AES-256 in G
     const vector<unsigned char>& key32, // 32 bytes symmetric key derived from SHA-256
     const vector<unsigned char>& plaintext // The original message
 ) {
+    TE_TIME(T_AEAD_ENCRYPT);
+    TE_COUNT(M_AEAD_ENCRYPT_BYTES, plaintext.size());
     if (key32.size() != 32) throw runtime_error("Error! AES-256 key must be 32 bytes!");
 
     const int NONCE_LEN = 12;
@@ -130,6 +151,7 @@ vector<unsigned char> aes256gcm_decrypt(  // Decrypt a message using AES-256 in
     const vector<unsigned char>& key32,   // 32 bytes symmetric key derived from SHA-256
     const vector<unsigned char>& full_enc_data // The encrypted data: nonce || ciphertext || tag
 ) {
+    TE_TIME(T_AEAD_DECRYPT);
     // Checking if the key length is correct
     if (key32.size() != 32) throw runtime_error("Error! AES-256 key must be 32 bytes!");
 
@@ -139,6 +161,7 @@ vector<unsigned char> aes256gcm_decrypt(  // Decrypt a message using AES-256 in
     // The encrypted data must at least contain a nonce and a tag
     if ((int)full_enc_data.size() < NONCE_LEN + TAG_LEN)
         throw runtime_error("Encrypted data is too short!");
+    TE_COUNT(M_AEAD_DECRYPT_BYTES, full_enc_data.size() - NONCE_LEN - TAG_LEN);
 
     // Extracting the nonce (first 12 bytes)
     const unsigned char* nonce = full_enc_data.data();
@@ -188,8 +211,10 @@ vector<unsigned char> aes256gcm_decrypt(  // Decrypt a message using AES-256 in
     EVP_CIPHER_CTX_free(ctx); // Freeing the decryption context, cleaning up memory
 
     // If the key is wrong or the ciphertext is modified, decryption fails here
-    if (ok != 1)
+    if (ok != 1) {
+        TE_COUNT(M_GCM_TAG_FAILURES, 1);
         throw runtime_error("DecryptFinal failed (tag mismatch / wrong key)");
+    }
 
     plaintext_len += len;
     plaintext.resize(plaintext_len);
@@ -200,4 +225,104 @@ vector<unsigned char> aes256gcm_decrypt(  // Decrypt a message using AES-256 in
 
 //---------------------------------------------------
 //-------------Decryption function ends--------------
-//---------------------------------------------------
\ No newline at end of file
+//---------------------------------------------------
+
+
+//-----------------------------------------------------
+//-------------AeadSession (many small messages)-------
+//-----------------------------------------------------
+
+/*
+The functions above create a new OpenSSL context, expand the AES key,
+call RAND_bytes and build three vectors for EVERY message.
+For millions of short messages that setup costs more than the encryption itself.
+A session does the setup once; afterwards only the nonce changes per message.
+
+Nonce = 8 random bytes (per session) || 4-byte message counter.
+The counter never repeats inside a session. Many sessions may use the same key (one per thread,
+all with sha256_of_ZZ(S)), so the random part must not repeat either: with 64 bits, two of
+N sessions pick the same prefix with probability about N^2 / 2^65 (a 32-bit prefix would
+already repeat after about 2^16 sessions, and a repeated GCM nonce leaks the authentication key).
+*/
+
+AeadSession::AeadSession(const vector<unsigned char>& key32) : enc_ctx(nullptr), dec_ctx(nullptr) {
+    if (key32.size() != 32) throw runtime_error("Error! AES-256 key must be 32 bytes!");
+
+    if (RAND_bytes(nonce_prefix, sizeof(nonce_prefix)) != 1) throw runtime_error("RAND_bytes nonce failed!!");
+
+    enc_ctx = EVP_CIPHER_CTX_new();
+    dec_ctx = EVP_CIPHER_CTX_new();
+    if (!enc_ctx || !dec_ctx) {
+        EVP_CIPHER_CTX_free(enc_ctx);
+        EVP_CIPHER_CTX_free(dec_ctx);
+        throw runtime_error("EVP_CIPHER_CTX_new failed!!");
+    }
+
+    // Expanding the key once for each direction (the nonce is set per message)
+    if (EVP_EncryptInit_ex(enc_ctx, EVP_aes_256_gcm(), nullptr, nullptr, nullptr) != 1 ||
+        EVP_CIPHER_CTX_ctrl(enc_ctx, EVP_CTRL_GCM_SET_IVLEN, NONCE_LEN, nullptr) != 1 ||
+        EVP_EncryptInit_ex(enc_ctx, nullptr, nullptr, key32.data(), nullptr) != 1 ||
+        EVP_DecryptInit_ex(dec_ctx, EVP_aes_256_gcm(), nullptr, nullptr, nullptr) != 1 ||
+        EVP_CIPHER_CTX_ctrl(dec_ctx, EVP_CTRL_GCM_SET_IVLEN, NONCE_LEN, nullptr) != 1 ||
+        EVP_DecryptInit_ex(dec_ctx, nullptr, nullptr, key32.data(), nullptr) != 1) {
+        EVP_CIPHER_CTX_free(enc_ctx);
+        EVP_CIPHER_CTX_free(dec_ctx);
+        throw runtime_error("AeadSession key setup failed!!");
+    }
+}
+
+AeadSession::~AeadSession() {
+    EVP_CIPHER_CTX_free(enc_ctx);
+    EVP_CIPHER_CTX_free(dec_ctx);
+}
+
+size_t AeadSession::seal(const unsigned char* plaintext, size_t len, unsigned char* out) {
+    if (len > (size_t)INT_MAX) throw runtime_error("Message is too long for one AEAD call!");
+    if (counter == UINT32_MAX) throw runtime_error("AeadSession nonce counter exhausted!");
+    TE_COUNT(M_AEAD_ENCRYPT_BYTES, len);
+
+    // nonce = prefix || counter (big-endian), written straight into the output
+    unsigned char* nonce = out;
+    memcpy(nonce, nonce_prefix, sizeof(nonce_prefix));
+    uint32_t c = counter++;
+    for (int i = 11; i >= 8; i--) { nonce[i] = (unsigned char)c; c >>= 8; }
+
+    unsigned char* ciphertext = out + NONCE_LEN;
+    int len1 = 0, len2 = 0;
+
+    if (EVP_EncryptInit_ex(enc_ctx, nullptr, nullptr, nullptr, nonce) != 1)
+        throw runtime_error("EncryptInit nonce failed!!");
+    if (EVP_EncryptUpdate(enc_ctx, ciphertext, &len1, plaintext, (int)len) != 1)
+        throw runtime_error("EncryptUpdate failed!!");
+    if (EVP_EncryptFinal_ex(enc_ctx, ciphertext + len1, &len2) != 1)
+        throw runtime_error("EncryptFinal failed!!");
+    if (EVP_CIPHER_CTX_ctrl(enc_ctx, EVP_CTRL_GCM_GET_TAG, TAG_LEN, ciphertext + len) != 1)
+        throw runtime_error("GET_TAG failed!!");
+
+    return len + OVERHEAD;
+}
+
+size_t AeadSession::open(const unsigned char* data, size_t len, unsigned char* out) {
+    if (len < OVERHEAD) throw runtime_error("Encrypted data is too short!");
+    if (len - OVERHEAD > (size_t)INT_MAX) throw runtime_error("Message is too long for one AEAD call!");
+
+    const unsigned char* nonce = data;
+    const unsigned char* ciphertext = data + NONCE_LEN;
+    size_t ciphertext_len = len - OVERHEAD;
+    const unsigned char* tag = data + len - TAG_LEN;
+    TE_COUNT(M_AEAD_DECRYPT_BYTES, ciphertext_len);
+
+    int len1 = 0, len2 = 0;
+    if (EVP_DecryptInit_ex(dec_ctx, nullptr, nullptr, nullptr, nonce) != 1)
+        throw runtime_error("DecryptInit nonce failed!!");
+    if (EVP_DecryptUpdate(dec_ctx, out, &len1, ciphertext, (int)ciphertext_len) != 1)
+        throw runtime_error("DecryptUpdate failed!!");
+    if (EVP_CIPHER_CTX_ctrl(dec_ctx, EVP_CTRL_GCM_SET_TAG, TAG_LEN, (void*)tag) != 1)
+        throw runtime_error("SET_TAG failed!!");
+    if (EVP_DecryptFinal_ex(dec_ctx, out + len1, &len2) != 1) {
+        TE_COUNT(M_GCM_TAG_FAILURES, 1);
+        throw runtime_error("DecryptFinal failed (tag mismatch / wrong key)");
+    }
+
+    return ciphertext_len;
+}
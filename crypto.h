@@ -2,6 +2,9 @@
 #include <NTL/ZZ.h>
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <openssl/evp.h>
+#include "workspace.h"
 
 using namespace NTL;
 using namespace std;
@@ -10,7 +13,12 @@ using namespace std;
 // Using encoding ZZ to bytes
 vector<unsigned char> sha256_of_ZZ(const ZZ& x);
 
+// Same hash written into digest (32 bytes), encoding x in the workspace's byte buffer
+// (no allocation). The encoding of x is wiped right after hashing.
+void sha256_of_ZZ(unsigned char digest[32], const ZZ& x, Workspace& ws);
+
 // Encryption function
+// (the whole message is in memory; for very large payloads use the streaming API in crypto_stream.h)
 vector<unsigned char> aes256gcm_encrypt(
     const vector<unsigned char>& key32,
     const vector<unsigned char>& plaintext
@@ -21,3 +29,36 @@ vector<unsigned char> aes256gcm_decrypt(
     const vector<unsigned char>& key32,
     const vector<unsigned char>& blob
 );
+
+// A reusable AES-256-GCM session for many small messages under ONE key.
+// The OpenSSL contexts and the AES key schedule are prepared once in the constructor,
+// nonces come from a counter, and seal/open write into caller buffers,
+// so encrypting or decrypting a message does not allocate.
+// The output format is the same as aes256gcm_encrypt: nonce || ciphertext || tag.
+// One session per thread (it is not safe to share one session between threads).
+// A session seals at most 2^32 - 1 messages (then start a new one).
+class AeadSession {
+public:
+    static const size_t NONCE_LEN = 12;
+    static const size_t TAG_LEN = 16;
+    static const size_t OVERHEAD = NONCE_LEN + TAG_LEN; // extra bytes per message
+
+    explicit AeadSession(const vector<unsigned char>& key32); // for example sha256_of_ZZ(S)
+    ~AeadSession();
+
+    AeadSession(const AeadSession&) = delete;
+    AeadSession& operator=(const AeadSession&) = delete;
+
+    // Encrypting len bytes; out needs room for len + OVERHEAD bytes. Returns the bytes written.
+    size_t seal(const unsigned char* plaintext, size_t len, unsigned char* out);
+
+    // Decrypting nonce || ciphertext || tag; out needs room for len - OVERHEAD bytes.
+    // Returns the plaintext length, throws on a wrong key or modified data.
+    size_t open(const unsigned char* data, size_t len, unsigned char* out);
+
+private:
+    EVP_CIPHER_CTX* enc_ctx;
+    EVP_CIPHER_CTX* dec_ctx;
+    unsigned char nonce_prefix[8]; // random per session (64 bits, so many sessions can share a key)
+    uint32_t counter = 0;          // message number, the rest of the nonce
+};
@@ -0,0 +1,231 @@
+/*
+This file implements the chunked (streaming) AES-256-GCM format described in crypto_stream.h.
+One OpenSSL context is prepared with the key once, and then only the nonce changes per chunk.
+*/
+
+#include "crypto_stream.h"
+#include "metrics.h"
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <unistd.h>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+static const unsigned char STREAM_MAGIC[4] = { 'T', 'E', 'G', 'S' };
+static const unsigned char STREAM_VERSION = 1;
+static const int NONCE_LEN = 12;
+static const int TAG_LEN = 16;
+static const size_t MIN_CHUNK = 1024;
+static const size_t MAX_CHUNK = 64 * 1024 * 1024;
+
+//-----------------------------------------------------
+//------------- Small helpers for file I/O ------------
+//-----------------------------------------------------
+
+// Reading up to n bytes (fewer only at end of file)
+static size_t read_full(int fd, unsigned char* buf, size_t n) {
+    size_t got = 0;
+    while (got < n) {
+        ssize_t r = read(fd, buf + got, n - got);
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0) throw runtime_error("read failed: " + string(strerror(errno)));
+        if (r == 0) break; // end of file
+        got += (size_t)r;
+    }
+    return got;
+}
+
+static void write_full(int fd, const unsigned char* buf, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, buf, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0) throw runtime_error("write failed: " + string(strerror(errno)));
+        buf += w;
+        n -= (size_t)w;
+    }
+}
+
+// nonce = prefix (7) || chunk index (4, big-endian) || last-chunk flag (1)
+static void chunk_nonce(unsigned char nonce[NONCE_LEN], const unsigned char* header, uint32_t index, bool last) {
+    memcpy(nonce, header + 5, 7);
+    nonce[7] = (unsigned char)(index >> 24);
+    nonce[8] = (unsigned char)(index >> 16);
+    nonce[9] = (unsigned char)(index >> 8);
+    nonce[10] = (unsigned char)index;
+    nonce[11] = last ? 1 : 0;
+}
+
+// Owning wrapper, so the context is freed even when we throw
+struct CipherCtx {
+    EVP_CIPHER_CTX* ctx;
+    CipherCtx() : ctx(EVP_CIPHER_CTX_new()) { if (!ctx) throw runtime_error("EVP_CIPHER_CTX_new failed!!"); }
+    ~CipherCtx() { EVP_CIPHER_CTX_free(ctx); }
+};
+
+//-----------------------------------------------------
+//------------- Streaming encryption ------------------
+//-----------------------------------------------------
+
+// A source fills buf with up to n bytes and returns how many (0 = end of data)
+typedef function<size_t(unsigned char* buf, size_t n)> Source;
+
+static uint64_t encrypt_chunks(const vector<unsigned char>& key32, const Source& source, int out_fd, size_t chunk_size) {
+    if (key32.size() != 32) throw runtime_error("Error! AES-256 key must be 32 bytes!");
+    if (chunk_size < MIN_CHUNK || chunk_size > MAX_CHUNK)
+        throw runtime_error("Stream chunk size must be between 1 KiB and 64 MiB!");
+
+    // Header: magic || version || random nonce prefix || chunk size
+    unsigned char header[STREAM_HEADER_LEN];
+    memcpy(header, STREAM_MAGIC, 4);
+    header[4] = STREAM_VERSION;
+    if (RAND_bytes(header + 5, 7) != 1) throw runtime_error("RAND_bytes nonce failed!!");
+    for (int i = 0; i < 4; i++) header[12 + i] = (unsigned char)(chunk_size >> (8 * i));
+    write_full(out_fd, header, STREAM_HEADER_LEN);
+
+    CipherCtx c;
+    if (EVP_EncryptInit_ex(c.ctx, EVP_aes_256_gcm(), nullptr, key32.data(), nullptr) != 1)
+        throw runtime_error("EncryptInit failed!!");
+    if (EVP_CIPHER_CTX_ctrl(c.ctx, EVP_CTRL_GCM_SET_IVLEN, NONCE_LEN, nullptr) != 1)
+        throw runtime_error("SET_IVLEN failed!!");
+
+    // Two plaintext buffers: the current chunk, and the next one (to know if the current one is last)
+    vector<unsigned char> cur(chunk_size), next(chunk_size), out(chunk_size + TAG_LEN);
+    size_t cur_len = source(cur.data(), chunk_size);
+    uint64_t total = 0;
+
+    for (uint32_t index = 0; ; index++) {
+        size_t next_len = (cur_len == chunk_size) ? source(next.data(), chunk_size) : 0;
+        bool last = (next_len == 0);
+
+        unsigned char nonce[NONCE_LEN];
+        chunk_nonce(nonce, header, index, last);
+
+        int len = 0;
+        if (EVP_EncryptInit_ex(c.ctx, nullptr, nullptr, nullptr, nonce) != 1)
+            throw runtime_error("EncryptInit nonce failed!!");
+        if (EVP_EncryptUpdate(c.ctx, nullptr, &len, header, STREAM_HEADER_LEN) != 1) // header as associated data
+            throw runtime_error("EncryptUpdate AAD failed!!");
+        if (EVP_EncryptUpdate(c.ctx, out.data(), &len, cur.data(), (int)cur_len) != 1)
+            throw runtime_error("EncryptUpdate failed!!");
+        TE_COUNT(M_AEAD_ENCRYPT_BYTES, cur_len);
+        int final_len = 0;
+        if (EVP_EncryptFinal_ex(c.ctx, out.data() + len, &final_len) != 1)
+            throw runtime_error("EncryptFinal failed!!");
+        if (EVP_CIPHER_CTX_ctrl(c.ctx, EVP_CTRL_GCM_GET_TAG, TAG_LEN, out.data() + cur_len) != 1)
+            throw runtime_error("GET_TAG failed!!");
+
+        write_full(out_fd, out.data(), cur_len + TAG_LEN);
+        total += cur_len;
+
+        if (last) break;
+        if (index == UINT32_MAX) throw runtime_error("Stream has too many chunks!");
+        swap(cur, next);
+        cur_len = next_len;
+    }
+
+    return total;
+}
+
+uint64_t aes256gcm_encrypt_stream(const vector<unsigned char>& key32, int in_fd, int out_fd, size_t chunk_size) {
+    return encrypt_chunks(key32, [in_fd](unsigned char* buf, size_t n) { return read_full(in_fd, buf, n); },
+                          out_fd, chunk_size);
+}
+
+uint64_t aes256gcm_encrypt_region(const vector<unsigned char>& key32, const unsigned char* data, size_t len,
+                                  int out_fd, size_t chunk_size) {
+    size_t pos = 0;
+    return encrypt_chunks(key32, [&](unsigned char* buf, size_t n) {
+        size_t take = min(n, len - pos);
+        memcpy(buf, data + pos, take);
+        pos += take;
+        return take;
+    }, out_fd, chunk_size);
+}
+
+//-----------------------------------------------------
+//------------- Streaming decryption ------------------
+//-----------------------------------------------------
+
+static uint64_t decrypt_chunks(const vector<unsigned char>& key32, const Source& source, int out_fd) {
+    if (key32.size() != 32) throw runtime_error("Error! AES-256 key must be 32 bytes!");
+
+    unsigned char header[STREAM_HEADER_LEN];
+    if (source(header, STREAM_HEADER_LEN) != STREAM_HEADER_LEN || memcmp(header, STREAM_MAGIC, 4) != 0)
+        throw runtime_error("Not an encrypted stream (bad header)!");
+    if (header[4] != STREAM_VERSION)
+        throw runtime_error("Unsupported encrypted stream version!");
+
+    size_t chunk_size = 0;
+    for (int i = 0; i < 4; i++) chunk_size |= (size_t)header[12 + i] << (8 * i);
+    if (chunk_size < MIN_CHUNK || chunk_size > MAX_CHUNK)
+        throw runtime_error("Encrypted stream has an invalid chunk size!");
+
+    CipherCtx c;
+    if (EVP_DecryptInit_ex(c.ctx, EVP_aes_256_gcm(), nullptr, key32.data(), nullptr) != 1)
+        throw runtime_error("DecryptInit failed!!");
+    if (EVP_CIPHER_CTX_ctrl(c.ctx, EVP_CTRL_GCM_SET_IVLEN, NONCE_LEN, nullptr) != 1)
+        throw runtime_error("SET_IVLEN failed!!");
+
+    // We read one byte past a full chunk: if it exists, the current chunk is not the last one
+    size_t record = chunk_size + TAG_LEN;
+    vector<unsigned char> in(record + 1), out(chunk_size);
+    size_t have = source(in.data(), record + 1);
+    uint64_t total = 0;
+
+    for (uint32_t index = 0; ; index++) {
+        bool last = (have <= record);
+        size_t rec_len = last ? have : record;
+        if (rec_len < (size_t)TAG_LEN) throw runtime_error("Encrypted stream is truncated!");
+        size_t ct_len = rec_len - TAG_LEN;
+
+        unsigned char nonce[NONCE_LEN];
+        chunk_nonce(nonce, header, index, last);
+
+        int len = 0;
+        if (EVP_DecryptInit_ex(c.ctx, nullptr, nullptr, nullptr, nonce) != 1)
+            throw runtime_error("DecryptInit nonce failed!!");
+        if (EVP_DecryptUpdate(c.ctx, nullptr, &len, header, STREAM_HEADER_LEN) != 1)
+            throw runtime_error("DecryptUpdate AAD failed!!");
+        if (EVP_DecryptUpdate(c.ctx, out.data(), &len, in.data(), (int)ct_len) != 1)
+            throw runtime_error("DecryptUpdate failed!!");
+        if (EVP_CIPHER_CTX_ctrl(c.ctx, EVP_CTRL_GCM_SET_TAG, TAG_LEN, in.data() + ct_len) != 1)
+            throw runtime_error("SET_TAG failed!!");
+        TE_COUNT(M_AEAD_DECRYPT_BYTES, ct_len);
+        int final_len = 0;
+        if (EVP_DecryptFinal_ex(c.ctx, out.data() + len, &final_len) != 1) {
+            TE_COUNT(M_GCM_TAG_FAILURES, 1);
+            throw runtime_error("Stream chunk " + to_string(index) +
+                                " failed (tag mismatch / wrong key / reordered or truncated stream)");
+        }
+
+        write_full(out_fd, out.data(), ct_len);
+        total += ct_len;
+
+        if (last) break;
+        if (index == UINT32_MAX) throw runtime_error("Stream has too many chunks!");
+
+        // Keeping the read-ahead byte and refilling the rest of the buffer
+        in[0] = in[record];
+        have = 1 + source(in.data() + 1, record);
+    }
+
+    return total;
+}
+
+uint64_t aes256gcm_decrypt_stream(const vector<unsigned char>& key32, int in_fd, int out_fd) {
+    return decrypt_chunks(key32, [in_fd](unsigned char* buf, size_t n) { return read_full(in_fd, buf, n); }, out_fd);
+}
+
+uint64_t aes256gcm_decrypt_region(const vector<unsigned char>& key32, const unsigned char* data, size_t len,
+                                  int out_fd) {
+    size_t pos = 0;
+    return decrypt_chunks(key32, [&](unsigned char* buf, size_t n) {
+        size_t take = min(n, len - pos);
+        memcpy(buf, data + pos, take);
+        pos += take;
+        return take;
+    }, out_fd);
+}
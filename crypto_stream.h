@@ -0,0 +1,64 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+/*
+Streaming AES-256-GCM for payloads that are too big to keep in memory.
+
+The plaintext is cut into chunks, and every chunk is encrypted and authenticated on its own:
+
+    header (16 bytes) = "TEGS" || version (1) || nonce prefix (7) || chunk size (4, little-endian)
+    chunk i           = ciphertext_i || tag_i (16)
+
+** nonce of chunk i = nonce prefix (7) || i (4, big-endian) || last-chunk flag (1)
+** the header is authenticated with every chunk (as GCM associated data)
+
+Because the chunk number is inside the nonce, swapping or repeating chunks breaks the tag.
+Because the last chunk is marked, cutting chunks off the end breaks the tag too.
+Only two chunk buffers are ever in memory, whatever the payload size.
+
+Note: plaintext is written out chunk by chunk (each chunk only after its tag is checked),
+so if decryption throws, the output written so far must be thrown away.
+*/
+
+const size_t STREAM_DEFAULT_CHUNK = 64 * 1024;
+const size_t STREAM_HEADER_LEN = 16;
+
+// Encrypting everything read from in_fd until end of file, writing the chunked format to out_fd.
+// Returns the number of plaintext bytes.
+uint64_t aes256gcm_encrypt_stream(
+    const vector<unsigned char>& key32,
+    int in_fd,
+    int out_fd,
+    size_t chunk_size = STREAM_DEFAULT_CHUNK
+);
+
+// Same, but the plaintext is a memory region (for example an mmap'd file).
+// The region is consumed chunk by chunk; nothing the size of the payload is allocated.
+uint64_t aes256gcm_encrypt_region(
+    const vector<unsigned char>& key32,
+    const unsigned char* data,
+    size_t len,
+    int out_fd,
+    size_t chunk_size = STREAM_DEFAULT_CHUNK
+);
+
+// Decrypting the chunked format read from in_fd, writing the plaintext to out_fd.
+// Throws on a wrong key, modified / reordered / missing chunks, or a cut-off stream.
+// Returns the number of plaintext bytes.
+uint64_t aes256gcm_decrypt_stream(
+    const vector<unsigned char>& key32,
+    int in_fd,
+    int out_fd
+);
+
+// Same, but the chunked data is a memory region (for example an mmap'd file)
+uint64_t aes256gcm_decrypt_region(
+    const vector<unsigned char>& key32,
+    const unsigned char* data,
+    size_t len,
+    int out_fd
+);
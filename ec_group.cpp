@@ -0,0 +1,167 @@
+/*
+This file wraps OpenSSL's elliptic curve arithmetic so that curve points
+can be used like the numbers mod p in the rest of the project (see ec_group.h).
+*/
+
+#include "ec_group.h"
+#include <openssl/bn.h>
+#include <openssl/obj_mac.h>
+#include <stdexcept>
+
+// Small owners for OpenSSL objects, so nothing leaks when an exception is thrown
+
+struct BnCtx {
+    BN_CTX* c;
+    BnCtx() : c(BN_CTX_new()) { if (!c) throw runtime_error("BN_CTX_new failed!"); }
+    ~BnCtx() { BN_CTX_free(c); }
+};
+
+struct Bn {
+    BIGNUM* b;
+    Bn() : b(BN_new()) { if (!b) throw runtime_error("BN_new failed!"); }
+    ~Bn() { BN_clear_free(b); } // scalars can be secret shares
+};
+
+struct Point {
+    EC_POINT* pt;
+    explicit Point(const EC_GROUP* g) : pt(EC_POINT_new(g)) { if (!pt) throw runtime_error("EC_POINT_new failed!"); }
+    ~Point() { EC_POINT_free(pt); }
+};
+
+static void bn_from_zz(BIGNUM* out, const ZZ& x) {
+    long len = NumBytes(x);
+    vector<unsigned char> buf(len > 0 ? len : 1);
+    BytesFromZZ(buf.data(), x, len);
+    if (!BN_lebin2bn(buf.data(), (int)len, out)) throw runtime_error("BN_lebin2bn failed!");
+}
+
+static ZZ zz_from_bn(const BIGNUM* x) {
+    int len = BN_num_bytes(x);
+    vector<unsigned char> buf(len > 0 ? len : 1);
+    BN_bn2lebinpad(x, buf.data(), len);
+    return ZZFromBytes(buf.data(), len);
+}
+
+EcCurve::EcCurve(const string& name) : grp(nullptr), label(name), enc_len(0) {
+    int nid = EC_curve_nist2nid(name.c_str());
+    if (nid == NID_undef) throw runtime_error("Unknown curve " + name + " (use P-256, P-384 or P-521)");
+
+    grp = EC_GROUP_new_by_curve_name(nid);
+    if (!grp) throw runtime_error("EC_GROUP_new_by_curve_name failed!");
+
+    BnCtx ctx;
+    Bn p, a, b, order, cofactor;
+    if (!EC_GROUP_get_curve(grp, p.b, a.b, b.b, ctx.c) || !EC_GROUP_get_order(grp, order.b, ctx.c)
+        || !EC_GROUP_get_cofactor(grp, cofactor.b, ctx.c)) {
+        EC_GROUP_free(grp);
+        throw runtime_error("Reading the curve parameters failed!");
+    }
+
+    // Exponents are reduced mod the order, which is only right if every point has that order
+    if (!BN_is_one(cofactor.b)) {
+        EC_GROUP_free(grp);
+        throw runtime_error("Only prime-order curves (cofactor 1) are supported!");
+    }
+
+    field_p = zz_from_bn(p.b);
+    n = zz_from_bn(order.b);
+    enc_len = 1 + 2 * NumBytes(field_p);
+    gen = encode(EC_GROUP_get0_generator(grp), ctx.c);
+}
+
+EcCurve::~EcCurve() {
+    EC_GROUP_free(grp);
+}
+
+void EcCurve::decode(EC_POINT* out, const ZZ& x, BN_CTX* ctx) const {
+    if (IsZero(x)) {
+        EC_POINT_set_to_infinity(grp, out);
+        return;
+    }
+    if (sign(x) < 0 || NumBytes(x) > enc_len) throw runtime_error("Not an encoded curve point!");
+
+    vector<unsigned char> buf(enc_len);
+    BytesFromZZ(buf.data(), x, enc_len);
+
+    // oct2point also checks that the point is on the curve
+    if (!EC_POINT_oct2point(grp, out, buf.data(), buf.size(), ctx))
+        throw runtime_error("Not a point on curve " + label + "!");
+}
+
+ZZ EcCurve::encode(const EC_POINT* P, BN_CTX* ctx) const {
+    if (EC_POINT_is_at_infinity(grp, P)) return ZZ(0);
+
+    vector<unsigned char> buf(enc_len);
+    size_t len = EC_POINT_point2oct(grp, P, POINT_CONVERSION_UNCOMPRESSED, buf.data(), buf.size(), ctx);
+    if (len != (size_t)enc_len) throw runtime_error("EC_POINT_point2oct failed!");
+
+    return ZZFromBytes(buf.data(), len);
+}
+
+ZZ EcCurve::power_g(const ZZ& e) const {
+    BnCtx ctx;
+    Bn k;
+    Point R(grp);
+
+    bn_from_zz(k.b, e % n);
+    if (!EC_POINT_mul(grp, R.pt, k.b, nullptr, nullptr, ctx.c)) throw runtime_error("EC_POINT_mul failed!");
+
+    return encode(R.pt, ctx.c);
+}
+
+ZZ EcCurve::power(const ZZ& x, const ZZ& e) const {
+    BnCtx ctx;
+    Bn k;
+    Point P(grp), R(grp);
+
+    decode(P.pt, x, ctx.c);
+    bn_from_zz(k.b, e % n);
+    if (!EC_POINT_mul(grp, R.pt, nullptr, P.pt, k.b, ctx.c)) throw runtime_error("EC_POINT_mul failed!");
+
+    return encode(R.pt, ctx.c);
+}
+
+ZZ EcCurve::mul(const ZZ& x, const ZZ& y) const {
+    BnCtx ctx;
+    Point P(grp), Q(grp);
+
+    decode(P.pt, x, ctx.c);
+    decode(Q.pt, y, ctx.c);
+    if (!EC_POINT_add(grp, P.pt, P.pt, Q.pt, ctx.c)) throw runtime_error("EC_POINT_add failed!");
+
+    return encode(P.pt, ctx.c);
+}
+
+ZZ EcCurve::multi_power(const vector<ZZ>& xs, const vector<ZZ>& es) const {
+    if (xs.size() != es.size()) throw runtime_error("multi_power: sizes of bases and exponents differ!");
+
+    BnCtx ctx;
+    Bn k;
+    Point sum(grp), P(grp), term(grp);
+    EC_POINT_set_to_infinity(grp, sum.pt);
+
+    // The points stay in OpenSSL's internal form until the end (one encoding for the result)
+    for (size_t i = 0; i < xs.size(); i++) {
+        decode(P.pt, xs[i], ctx.c);
+        bn_from_zz(k.b, es[i] % n);
+        if (!EC_POINT_mul(grp, term.pt, nullptr, P.pt, k.b, ctx.c) || !EC_POINT_add(grp, sum.pt, sum.pt, term.pt, ctx.c))
+            throw runtime_error("EC multi_power failed!");
+    }
+
+    return encode(sum.pt, ctx.c);
+}
+
+bool EcCurve::is_element(const ZZ& x) const {
+    try {
+        BnCtx ctx;
+        Point P(grp);
+        decode(P.pt, x, ctx.c);
+        return true;
+    } catch (const runtime_error&) {
+        return false;
+    }
+}
+
+shared_ptr<const EcCurve> make_ec_curve(const string& name) {
+    return make_shared<const EcCurve>(name);
+}
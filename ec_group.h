@@ -0,0 +1,59 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <NTL/ZZ.h>
+#include <openssl/ec.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace NTL;
+using namespace std;
+
+/*
+A prime-order elliptic curve (NIST P-256 / P-384 / P-521) through OpenSSL's EC API,
+used as the ElGamal group instead of the numbers mod p.
+
+Points are passed around as ZZ, so the rest of the code (shares, ciphertexts, partials,
+sha256_of_ZZ) does not change: a point is its uncompressed SEC1 encoding 04 || X || Y,
+read as a little-endian number, and the point at infinity is 0.
+
+The group is written multiplicatively everywhere else, so here
+    "power(x, e)" is the scalar multiplication e*x and "mul(x, y)" is the point addition x + y.
+*/
+class EcCurve {
+public:
+    // name is a NIST curve name: "P-256", "P-384" or "P-521"
+    explicit EcCurve(const string& name);
+    ~EcCurve();
+
+    EcCurve(const EcCurve&) = delete;
+    EcCurve& operator=(const EcCurve&) = delete;
+
+    const char* name() const { return label.c_str(); }
+    long element_bytes() const { return enc_len; }  // bytes of an encoded point
+
+    const ZZ& field_prime() const { return field_p; }
+    const ZZ& order() const { return n; }          // prime order of the curve (plays the role of q)
+    const ZZ& generator() const { return gen; }    // encoded base point
+
+    ZZ power_g(const ZZ& e) const;                                  // e * G (OpenSSL's generator tables)
+    ZZ power(const ZZ& x, const ZZ& e) const;                       // e * x
+    ZZ mul(const ZZ& x, const ZZ& y) const;                         // x + y
+    ZZ multi_power(const vector<ZZ>& xs, const vector<ZZ>& es) const; // e_1 * x_1 + e_2 * x_2 + ...
+
+    // Whether x encodes a point of the curve (or the point at infinity)
+    bool is_element(const ZZ& x) const;
+
+private:
+    EC_GROUP* grp;
+    string label;
+    long enc_len;
+    ZZ field_p;
+    ZZ n;
+    ZZ gen;
+
+    void decode(EC_POINT* out, const ZZ& x, BN_CTX* ctx) const; // throws if x is not a point
+    ZZ encode(const EC_POINT* P, BN_CTX* ctx) const;
+};
+
+// The curve for a NIST name, or an exception for an unknown name
+shared_ptr<const EcCurve> make_ec_curve(const string& name);
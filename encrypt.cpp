@@ -0,0 +1,185 @@
+/*
+This file implements encryption to threshold public keys (see encrypt.h):
+one-off encryption, the Encryptor with its LRU of per-key fixed-base tables,
+and multi-recipient encryption with one ephemeral b and a wrapped data key per recipient.
+*/
+
+#include "encrypt.h"
+#include "crypto.h"
+#include "metrics.h"
+#include "subgroup.h"
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+#include <stdexcept>
+#include <string>
+
+// A public key must be an element of the subgroup of order q other than the identity
+// (1, or the point at infinity encoded as 0): otherwise A^b is known or leaks b modulo a small order.
+// On the prime-field group this costs one exponentiation (the Encryptor does it once per key).
+static void check_public_key(const ZZ& A, const Group& G) {
+    bool identity = G.curve ? IsZero(A) : IsOne(A);
+    if (identity || !in_subgroup(A, G))
+        throw runtime_error("Public key is not an element of the group!!");
+}
+
+// key = SHA256(S), aead = AES-256-GCM(key, plaintext)
+static vector<unsigned char> seal_with_secret(const ZZ& S, const vector<unsigned char>& plaintext) {
+    vector<unsigned char> key = sha256_of_ZZ(S);
+    vector<unsigned char> aead = aes256gcm_encrypt(key, plaintext);
+    OPENSSL_cleanse(key.data(), key.size());
+    return aead;
+}
+
+Ciphertext encrypt(const ZZ& A, const vector<unsigned char>& plaintext, const Group& G) {
+    check_public_key(A, G);
+
+    ZZ b = RandomBnd(G.q);
+    Ciphertext ct;
+    ct.B = group_power_g(G, b);
+    ct.aead = seal_with_secret(group_power(G, A, b), plaintext);
+    return ct;
+}
+
+vector<unsigned char> open_multi(const ZZ& S, const MultiCiphertext& ct, size_t recipient) {
+    if (recipient >= ct.wrapped_keys.size())
+        throw runtime_error("Recipient " + to_string(recipient) + " is not in this ciphertext!");
+
+    vector<unsigned char> key = sha256_of_ZZ(S);
+    vector<unsigned char> dek = aes256gcm_decrypt(key, ct.wrapped_keys[recipient]); // throws for a wrong S
+    OPENSSL_cleanse(key.data(), key.size());
+
+    vector<unsigned char> plaintext = aes256gcm_decrypt(dek, ct.aead);
+    OPENSSL_cleanse(dek.data(), dek.size());
+    return plaintext;
+}
+
+Encryptor::Encryptor(const Group& G, size_t capacity, long window, long min_uses)
+    : G(G), capacity(capacity), window(window), min_uses(min_uses) {
+    if (capacity == 0) throw runtime_error("Encryptor capacity must be at least 1!");
+    if (min_uses < 1) throw runtime_error("Encryptor min_uses must be at least 1!");
+    if (window < 1 || window > 16) throw runtime_error("Fixed-base window must be between 1 and 16 bits!");
+}
+
+ZZ Encryptor::power(const ZZ& A, const ZZ& e) {
+    if (G.curve) {
+        check_public_key(A, G); // only decoding the point, no cache needed
+        return group_power(G, A, e);
+    }
+
+    shared_ptr<const FixedBase> table;
+    bool build = false;
+    bool unchecked = false;
+    {
+        lock_guard<mutex> lk(m);
+        auto it = entries.find(A);
+        if (it == entries.end()) {
+            lru.push_front(A);
+            it = entries.emplace(A, Entry()).first;
+            it->second.lru_pos = lru.begin();
+        } else {
+            lru.splice(lru.begin(), lru, it->second.lru_pos); // most recently used goes to the front
+        }
+
+        Entry& entry = it->second;
+        unchecked = !entry.checked;
+        entry.uses++;
+        table = entry.table;
+        build = !table && entry.uses == min_uses; // exactly one call builds the table
+        if (table) hit_count++;
+
+        if (entries.size() > capacity) { // evicting the least recently used key (never A itself)
+            auto old = entries.find(lru.back());
+            if (old->second.table) table_count--;
+            entries.erase(old);
+            lru.pop_back();
+        }
+    }
+
+    // A new key is checked once (outside the lock); the result stays with its LRU entry
+    if (unchecked) {
+        try {
+            check_public_key(A, G);
+        } catch (...) {
+            lock_guard<mutex> lk(m);
+            auto it = entries.find(A);
+            if (it != entries.end() && !it->second.checked) { // a bad key does not keep a slot
+                if (it->second.table) table_count--;
+                lru.erase(it->second.lru_pos);
+                entries.erase(it);
+            }
+            throw;
+        }
+        lock_guard<mutex> lk(m);
+        auto it = entries.find(A);
+        if (it != entries.end()) it->second.checked = true;
+    }
+
+    if (table) {
+        TE_COUNT(M_FIXED_BASE_POWER, 1);
+        return fixed_base_power(*table, e);
+    }
+    if (!build) return group_power(G, A, e);
+
+    // Building outside the lock, so other threads can keep encrypting meanwhile
+    auto fb = make_shared<FixedBase>();
+    fixed_base_init(*fb, A, G.p, NumBits(G.q), window);
+    {
+        lock_guard<mutex> lk(m);
+        build_count++;
+        auto it = entries.find(A);
+        if (it != entries.end() && !it->second.table) { // A may have been evicted meanwhile
+            it->second.table = fb;
+            table_count++;
+        }
+    }
+
+    TE_COUNT(M_FIXED_BASE_POWER, 1);
+    return fixed_base_power(*fb, e);
+}
+
+Ciphertext Encryptor::encrypt(const ZZ& A, const vector<unsigned char>& plaintext) {
+    ZZ b = RandomBnd(G.q);
+    Ciphertext ct;
+    ct.B = group_power_g(G, b);
+    ct.aead = seal_with_secret(power(A, b), plaintext);
+    return ct;
+}
+
+MultiCiphertext Encryptor::encrypt_multi(const vector<ZZ>& As, const vector<unsigned char>& plaintext) {
+    if (As.empty()) throw runtime_error("Multi-recipient encryption needs at least one public key!");
+
+    ZZ b = RandomBnd(G.q);
+    MultiCiphertext ct;
+    ct.B = group_power_g(G, b);
+
+    // Every A_i^b first (power checks each key, once per key thanks to the cache),
+    // so a bad key fails the call before anything is encrypted
+    vector<ZZ> secrets;
+    for (auto& A : As) secrets.push_back(power(A, b));
+
+    // The message is encrypted only once, under a fresh random data key
+    vector<unsigned char> dek(32);
+    if (RAND_bytes(dek.data(), (int)dek.size()) != 1) throw runtime_error("RAND_bytes DEK failed!!");
+    ct.aead = aes256gcm_encrypt(dek, plaintext);
+
+    // Every recipient gets the data key under SHA256(A_i^b), with the same b
+    for (auto& S : secrets) ct.wrapped_keys.push_back(seal_with_secret(S, dek));
+
+    OPENSSL_cleanse(dek.data(), dek.size());
+    return ct;
+}
+
+size_t Encryptor::tables() const {
+    lock_guard<mutex> lk(m);
+    return table_count;
+}
+
+size_t Encryptor::table_hits() const {
+    lock_guard<mutex> lk(m);
+    return hit_count;
+}
+
+size_t Encryptor::table_builds() const {
+    lock_guard<mutex> lk(m);
+    return build_count;
+}
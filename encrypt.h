@@ -0,0 +1,90 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <NTL/ZZ.h>
+#include <vector>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "group.h"
+#include "threshold.h"
+
+using namespace NTL;
+using namespace std;
+
+/*
+The sender's side of the hybrid scheme: encrypting to a threshold public key A = g^a.
+
+    b random,  B = g^b,  S = A^b,  key = SHA256(S),  aead = AES-256-GCM(key, message)
+
+g^b always uses the group's table of g, but A^b is a full exponentiation for every message.
+Senders encrypt to the same few hundred committees over and over, so an Encryptor keeps a
+fixed-base table for every public key it sees repeatedly (bounded, the least recently used
+key is dropped first). A message to such a key costs about two table exponentiations.
+
+Multi-recipient mode: ONE b and ONE B = g^b for all recipients. The message is encrypted once
+under a random data key (DEK), and the DEK is wrapped for every recipient with its own A_i^b.
+Each committee threshold-decrypts the same B, with its own shares, and only gets its own A_i^b.
+*/
+
+// One-off encryption (no cache). threshold_decrypt_batch decrypts the result.
+// Throws if A is the identity or not in the subgroup of order q (one extra exponentiation).
+Ciphertext encrypt(const ZZ& A, const vector<unsigned char>& plaintext, const Group& G);
+
+struct MultiCiphertext {
+    ZZ B;                                        // g^b, the same for all recipients
+    vector<vector<unsigned char>> wrapped_keys;  // wrapped_keys[i] = AES-256-GCM(SHA256(A_i^b), DEK)
+    vector<unsigned char> aead;                  // AES-256-GCM(DEK, message)
+};
+
+// Committee of recipient i, after threshold-decrypting ct.B with its shares (S = A_i^b)
+vector<unsigned char> open_multi(const ZZ& S, const MultiCiphertext& ct, size_t recipient);
+
+// Encryption with a cache of fixed-base tables for hot public keys.
+// A key gets its table the min_uses-th time it is used (a table costs a few exponentiations
+// to build, so keys that are used only once never pay for it). At most capacity keys are
+// remembered; a table takes about (bits of q / window) * (2^window - 1) numbers mod p
+// (about 1 MB for the 4093-bit group with window 4).
+// Only the prime-field group has tables; on a curve every A^b is a normal scalar multiplication.
+// Safe to use from several threads. The Group must outlive the encryptor.
+class Encryptor {
+public:
+    explicit Encryptor(const Group& G, size_t capacity = 256, long window = 4, long min_uses = 2);
+
+    Ciphertext encrypt(const ZZ& A, const vector<unsigned char>& plaintext);
+
+    // One b for all recipients (As may repeat a key; each entry gets its own wrapped DEK)
+    MultiCiphertext encrypt_multi(const vector<ZZ>& As, const vector<unsigned char>& plaintext);
+
+    // A^e, from A's table if it has one (counts as a use of A).
+    // Throws if A is not an element of the subgroup of order q, or is the identity
+    // (checked the first time A is seen; the result is kept with A in the cache).
+    ZZ power(const ZZ& A, const ZZ& e);
+
+    size_t tables() const;       // keys that currently have a table
+    size_t table_hits() const;   // exponentiations served from a table
+    size_t table_builds() const;
+
+private:
+    struct ZZLess {
+        bool operator()(const ZZ& a, const ZZ& b) const { return compare(a, b) < 0; }
+    };
+
+    struct Entry {
+        long uses = 0;
+        bool checked = false;               // A passed check_public_key (done once per key)
+        shared_ptr<const FixedBase> table;  // nullptr until the key is hot
+        list<ZZ>::iterator lru_pos;
+    };
+
+    const Group& G;
+    size_t capacity;
+    long window;
+    long min_uses;
+
+    mutable mutex m;
+    list<ZZ> lru;                     // public keys, most recently used first
+    map<ZZ, Entry, ZZLess> entries;
+    size_t table_count = 0;
+    size_t hit_count = 0;
+    size_t build_count = 0;
+};
@@ -0,0 +1,152 @@
+/*
+This file implements batch envelopes (see envelope.h): one ElGamal encapsulation,
+HKDF-SHA256 per-message keys and nonces, and AES-256-GCM records.
+*/
+
+#include "envelope.h"
+#include "metrics.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include <openssl/core_names.h>
+#include <stdexcept>
+#include <cstring>
+
+// HKDF info prefix, without the terminating 0 (the index follows it)
+static const char BATCH_INFO[] = "threshold-elgamal batch v1";
+static const size_t BATCH_INFO_LEN = sizeof(BATCH_INFO) - 1;
+
+// Fixed-width encoding of a group element (so both sides hash exactly the same bytes)
+static vector<unsigned char> element_bytes(const ZZ& x, const Group& G) {
+    vector<unsigned char> out(group_element_bytes(G));
+    BytesFromZZ(out.data(), x, (long)out.size());
+    return out;
+}
+
+// Frees the OpenSSL context when leaving the function (also on exceptions)
+struct CipherCtx {
+    EVP_CIPHER_CTX* ctx;
+    CipherCtx() : ctx(EVP_CIPHER_CTX_new()) { if (!ctx) throw runtime_error("EVP_CIPHER_CTX_new failed!!"); }
+    ~CipherCtx() { EVP_CIPHER_CTX_free(ctx); }
+};
+
+// One HKDF-SHA256 step with OpenSSL's implementation (mode: extract only or expand only).
+// The HKDF algorithm is fetched from the provider once, a context per call is cheap.
+static bool hkdf(int mode, const unsigned char* key, size_t key_len, const unsigned char* salt, size_t salt_len,
+                 const unsigned char* info, size_t info_len, unsigned char* out, size_t out_len) {
+    static EVP_KDF* kdf = EVP_KDF_fetch(nullptr, "HKDF", nullptr); // thread-safe, shared by every thread
+    if (!kdf) return false;
+    EVP_KDF_CTX* kctx = EVP_KDF_CTX_new(kdf);
+    if (!kctx) return false;
+
+    char digest[] = "SHA256";
+    OSSL_PARAM params[6], *p = params;
+    *p++ = OSSL_PARAM_construct_utf8_string(OSSL_KDF_PARAM_DIGEST, digest, 0);
+    *p++ = OSSL_PARAM_construct_int(OSSL_KDF_PARAM_MODE, &mode);
+    *p++ = OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_KEY, (void*)key, key_len);
+    if (salt_len > 0) *p++ = OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_SALT, (void*)salt, salt_len);
+    if (info_len > 0) *p++ = OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_INFO, (void*)info, info_len);
+    *p = OSSL_PARAM_construct_end();
+
+    bool ok = EVP_KDF_derive(kctx, out, out_len, params) == 1;
+    EVP_KDF_CTX_free(kctx);
+    return ok;
+}
+
+BatchKey::BatchKey(const ZZ& S, const ZZ& B, const Group& G) {
+    // HKDF-Extract: PRK = HMAC-SHA256(salt = B, S)
+    vector<unsigned char> salt = element_bytes(B, G);
+    vector<unsigned char> ikm = element_bytes(S, G);
+
+    bool ok = hkdf(EVP_PKEY_HKDEF_MODE_EXTRACT_ONLY, ikm.data(), ikm.size(), salt.data(), salt.size(),
+                   nullptr, 0, prk, sizeof(prk));
+    OPENSSL_cleanse(ikm.data(), ikm.size());
+    if (!ok) throw runtime_error("HKDF-Extract failed!!");
+}
+
+BatchKey::~BatchKey() {
+    OPENSSL_cleanse(prk, sizeof(prk));
+}
+
+void BatchKey::message_key(uint64_t index, unsigned char key[32], unsigned char nonce[12]) const {
+    // HKDF-Expand for 44 bytes, info = "threshold-elgamal batch v1" || index (8 bytes, little-endian)
+    unsigned char info[BATCH_INFO_LEN + 8];
+    memcpy(info, BATCH_INFO, BATCH_INFO_LEN);
+    for (int k = 0; k < 8; k++) info[BATCH_INFO_LEN + k] = (unsigned char)(index >> (8 * k));
+
+    unsigned char okm[44];
+    bool ok = hkdf(EVP_PKEY_HKDEF_MODE_EXPAND_ONLY, prk, sizeof(prk), nullptr, 0, info, sizeof(info), okm, sizeof(okm));
+    if (ok) {
+        memcpy(key, okm, 32);
+        memcpy(nonce, okm + 32, 12);
+    }
+    OPENSSL_cleanse(okm, sizeof(okm));
+    if (!ok) throw runtime_error("HKDF-Expand failed!!");
+}
+
+vector<unsigned char> BatchKey::seal(uint64_t index, const vector<unsigned char>& message) const {
+    unsigned char key[32], nonce[12];
+    message_key(index, key, nonce);
+
+    CipherCtx c;
+    vector<unsigned char> record(message.size() + TAG_LEN);
+    int len = 0;
+
+    bool ok = EVP_EncryptInit_ex(c.ctx, EVP_aes_256_gcm(), nullptr, key, nonce) == 1
+              && EVP_EncryptUpdate(c.ctx, record.data(), &len, message.data(), (int)message.size()) == 1
+              && EVP_EncryptFinal_ex(c.ctx, record.data() + len, &len) == 1
+              && EVP_CIPHER_CTX_ctrl(c.ctx, EVP_CTRL_GCM_GET_TAG, TAG_LEN, record.data() + message.size()) == 1;
+    OPENSSL_cleanse(key, sizeof(key));
+
+    if (!ok) throw runtime_error("Batch record encryption failed!!");
+    TE_COUNT(M_AEAD_ENCRYPT_BYTES, message.size());
+    return record;
+}
+
+vector<unsigned char> BatchKey::open(uint64_t index, const vector<unsigned char>& record) const {
+    if (record.size() < TAG_LEN) throw runtime_error("Batch record is too short!");
+
+    unsigned char key[32], nonce[12];
+    message_key(index, key, nonce);
+
+    CipherCtx c;
+    size_t ct_len = record.size() - TAG_LEN;
+    vector<unsigned char> message(ct_len);
+    int len = 0, final_len = 0;
+
+    bool ok = EVP_DecryptInit_ex(c.ctx, EVP_aes_256_gcm(), nullptr, key, nonce) == 1
+              && EVP_DecryptUpdate(c.ctx, message.data(), &len, record.data(), (int)ct_len) == 1
+              && EVP_CIPHER_CTX_ctrl(c.ctx, EVP_CTRL_GCM_SET_TAG, TAG_LEN, (void*)(record.data() + ct_len)) == 1
+              && EVP_DecryptFinal_ex(c.ctx, message.data() + len, &final_len) == 1;
+    OPENSSL_cleanse(key, sizeof(key));
+
+    // A wrong S, a modified record or a record moved to another index all end here
+    TE_COUNT(M_AEAD_DECRYPT_BYTES, ct_len);
+    if (!ok) {
+        TE_COUNT(M_GCM_TAG_FAILURES, 1);
+        throw runtime_error("Batch record " + to_string(index) + ": tag mismatch / wrong key");
+    }
+    return message;
+}
+
+BatchKey batch_encapsulate(const ZZ& A, const Group& G, ZZ& B) {
+    ZZ b = RandomBnd(G.q);
+    B = group_power_g(G, b);
+    return BatchKey(group_power(G, A, b), B, G);
+}
+
+BatchEnvelope batch_encrypt(const ZZ& A, const vector<vector<unsigned char>>& messages, const Group& G) {
+    BatchEnvelope env;
+    BatchKey key = batch_encapsulate(A, G, env.B);
+
+    env.records.reserve(messages.size());
+    for (size_t i = 0; i < messages.size(); i++)
+        env.records.push_back(key.seal(i, messages[i]));
+
+    return env;
+}
+
+vector<unsigned char> batch_open_record(const BatchKey& key, const BatchEnvelope& env, size_t index) {
+    if (index >= env.records.size()) throw runtime_error("Batch record index out of range!");
+    return key.open(index, env.records[index]);
+}
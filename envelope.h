@@ -0,0 +1,58 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <NTL/ZZ.h>
+#include <cstdint>
+#include <vector>
+#include "group.h"
+
+using namespace NTL;
+using namespace std;
+
+/*
+Batch envelopes: ONE ElGamal encapsulation for a whole batch of messages.
+
+    sender:     B = g^b,  S = A^b                     (once per batch)
+                PRK = HKDF-Extract(salt = B, S)
+                key_i || nonce_i = HKDF-Expand(PRK, "threshold-elgamal batch v1" || i, 44 bytes)
+                record_i = AES-256-GCM(key_i, nonce_i, message_i)   = ciphertext || tag
+
+    committee:  one threshold decryption of B gives S, which unlocks every record of the batch.
+                Any record can be opened on its own (random access), only its index is needed.
+
+HKDF is RFC 5869 with HMAC-SHA256 (OpenSSL's implementation). The info is the 26 characters
+of the string (no terminating 0) followed by i as 8 little-endian bytes. Every message has its
+own key, so the index can never repeat a (key, nonce) pair, and swapping records is detected
+(the wrong key fails the tag).
+*/
+
+// The per-batch secret (after HKDF-Extract), from which every message key is derived
+class BatchKey {
+public:
+    static const size_t TAG_LEN = 16; // bytes added to every record
+
+    // S = A^b (sender) or the threshold-decrypted S (committee), B = the batch's g^b
+    BatchKey(const ZZ& S, const ZZ& B, const Group& G);
+    ~BatchKey(); // wipes the secret
+
+    // AES-256 key and GCM nonce of message index
+    void message_key(uint64_t index, unsigned char key[32], unsigned char nonce[12]) const;
+
+    vector<unsigned char> seal(uint64_t index, const vector<unsigned char>& message) const;
+    vector<unsigned char> open(uint64_t index, const vector<unsigned char>& record) const; // throws on tag mismatch
+
+private:
+    unsigned char prk[32];
+};
+
+struct BatchEnvelope {
+    ZZ B;                                   // the only ElGamal part of the batch
+    vector<vector<unsigned char>> records;  // record i = AES-256-GCM ciphertext || tag of message i
+};
+
+// Sender: new encapsulation to public key A. B receives g^b, the key seals any number of messages.
+BatchKey batch_encapsulate(const ZZ& A, const Group& G, ZZ& B);
+
+// Sender: encrypting all messages of a batch at once
+BatchEnvelope batch_encrypt(const ZZ& A, const vector<vector<unsigned char>>& messages, const Group& G);
+
+// Committee side, after S was obtained from env.B by one threshold decryption (partials + combine)
+vector<unsigned char> batch_open_record(const BatchKey& key, const BatchEnvelope& env, size_t index);
@@ -0,0 +1,95 @@
+/*
+This file implements Feldman commitments for Shamir shares and the share checks (see feldman.h).
+*/
+
+#include "feldman.h"
+#include <stdexcept>
+
+vector<Share> feldman_split(const ZZ& secret, long t, long n, const Group& G,
+                            vector<ZZ>& commitments, ThreadPool* pool) {
+    if (n <= 0) throw runtime_error("Number of players must be positive!");
+
+    vector<ZZ> coeffs = shamir_random_polynomial(secret, t, G);
+
+    // C_j = g^(coef_j) with the precomputed table of g (or the curve's base point)
+    commitments.clear();
+    for (auto& c : coeffs) commitments.push_back(group_power_g(G, c));
+
+    // Every index is written by exactly one task, so the sink needs no lock
+    vector<Share> shares(n);
+    shamir_split_stream(coeffs, n, G, [&](long i, const ZZ& v) {
+        shares[i - 1].index = i;
+        shares[i - 1].value = v;
+    }, pool);
+
+    return shares;
+}
+
+bool feldman_check_commitments(const vector<ZZ>& commitments, const Group& G) {
+    if (commitments.empty()) return false;
+
+    for (auto& C : commitments) {
+        if (G.curve) {
+            if (!G.curve->is_element(C)) return false;
+        } else {
+            if (C <= 0 || C >= G.p) return false;
+            if (group_power(G, C, G.q) != 1) return false; // order divides q
+        }
+    }
+    return true;
+}
+
+bool feldman_verify_share(const Share& share, const vector<ZZ>& commitments, const Group& G) {
+    if (commitments.empty()) throw runtime_error("No Feldman commitments to check against!");
+    if (share.index <= 0) return false;
+
+    ZZ i(share.index);
+    size_t t = commitments.size() - 1;
+
+    // ∏ C_j^(i^j) = (((C_t)^i * C_(t-1))^i * ... )^i * C_0
+    ZZ rhs = commitments[t];
+    for (size_t j = t; j-- > 0;)
+        rhs = group_mul(G, group_power(G, rhs, i), commitments[j]);
+
+    return group_power_g(G, share.value % G.q) == rhs;
+}
+
+bool feldman_verify_shares_batch(const vector<Share>& shares, const vector<ZZ>& commitments, const Group& G) {
+    if (commitments.empty()) throw runtime_error("No Feldman commitments to check against!");
+    if (shares.empty()) return true;
+
+    size_t t = commitments.size() - 1;
+
+    // Left side exponent: Σ δ_i a_i;  right side exponents: E_j = Σ δ_i i^j  (all mod q)
+    ZZ lhs_exp(0);
+    vector<ZZ> E(t + 1, ZZ(0));
+    ZZ x, pw;
+
+    for (auto& s : shares) {
+        if (s.index <= 0) return false;
+
+        ZZ delta = RandomBits_ZZ(128) + 1;
+        lhs_exp += delta * (s.value % G.q);
+
+        // δ_i i^j for j = 0 .. t, one multiplication by i per step
+        conv(x, s.index);
+        pw = delta % G.q;
+        for (size_t j = 0; j <= t; j++) {
+            AddMod(E[j], E[j], pw, G.q);
+            if (j < t) MulMod(pw, pw, x, G.q);
+        }
+    }
+
+    ZZ rhs = group_multi_power(G, commitments, E);
+    return group_power_g(G, lhs_exp % G.q) == rhs;
+}
+
+vector<long> feldman_find_bad_shares(const vector<Share>& shares, const vector<ZZ>& commitments, const Group& G) {
+    vector<long> bad;
+    if (feldman_verify_shares_batch(shares, commitments, G)) return bad;
+
+    for (auto& s : shares) {
+        if (!feldman_verify_share(s, commitments, G)) bad.push_back(s.index);
+    }
+    return bad;
+}
@@ -0,0 +1,58 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <NTL/ZZ.h>
+#include <vector>
+#include "group.h"
+#include "shamir.h"
+#include "threadpool.h"
+
+using namespace NTL;
+using namespace std;
+
+/*
+Feldman verifiable secret sharing.
+
+The dealer picks f(x) = coef_0 + coef_1 x + ... + coef_t x^t with coef_0 = secret,
+hands a_i = f(i) to player i (privately) and publishes the commitments
+
+    C_j = g^(coef_j),   j = 0 .. t        (C_0 = g^secret is the public key)
+
+Player i can then check its share without learning anything else:
+
+    g^(a_i) == ∏_j C_j^(i^j)
+
+Checking all n shares one by one costs n products of t+1 powers. The batch check instead
+picks random 128-bit δ_i and tests ONE equation
+
+    g^(Σ_i δ_i a_i) == ∏_j C_j^(Σ_i δ_i i^j)
+
+which is one fixed-base power of g (with the table of g) and one multi-exponentiation of t+1
+terms for the whole committee. If some share is wrong it returns false except with
+probability about 2^-128. Works on both kinds of group (numbers mod p and elliptic curves).
+*/
+
+// Splitting secret into n shares with threshold t, and computing the commitments C_0 .. C_t.
+// The shares are evaluated with shamir_split_stream (on the pool if one is given).
+vector<Share> feldman_split(
+    const ZZ& secret,
+    long t,
+    long n,
+    const Group& G,
+    vector<ZZ>& commitments,
+    ThreadPool* pool = nullptr
+);
+
+// Checking that every commitment is an element of the group of order q
+// (exactly: C^q == 1 mod p, or a valid curve point). Done once per dealing, before
+// trusting the share checks below, which assume the commitments are in the group.
+bool feldman_check_commitments(const vector<ZZ>& commitments, const Group& G);
+
+// Checking one share exactly: g^(a_i) == ∏ C_j^(i^j), with the right side in Horner form
+// (((C_t)^i * C_(t-1))^i * ...) * C_0, so every power has the small exponent i
+bool feldman_verify_share(const Share& share, const vector<ZZ>& commitments, const Group& G);
+
+// Checking all shares at once with a random linear combination (see above)
+bool feldman_verify_shares_batch(const vector<Share>& shares, const vector<ZZ>& commitments, const Group& G);
+
+// Batch check first; only if it fails, every share is checked on its own.
+// Returns the indices of the players whose shares are wrong (empty if all are fine).
+vector<long> feldman_find_bad_shares(const vector<Share>& shares, const vector<ZZ>& commitments, const Group& G);
@@ -0,0 +1,68 @@
+/*
+This file implements fixed-base exponentiation.
+The base g and the modulus p never change, but we raise g to a new exponent
+for every public key (A = g^a) and for every encrypted message (B = g^b).
+So we pay once to precompute powers of g, and afterwards every g^e is only
+a product of table entries: one multiplication per w-bit window of e,
+instead of one squaring per bit plus the multiplications of PowerMod.
+*/
+
+#include "fixedbase.h"
+#include <stdexcept>
+
+void fixed_base_init(FixedBase& fb, const ZZ& base, const ZZ& p, long max_bits, long window) {
+    if (window < 1 || window > 16) throw runtime_error("Fixed-base window must be between 1 and 16 bits!");
+    if (max_bits < 1) throw runtime_error("Fixed-base table needs max_bits >= 1!");
+
+    fb.base = base % p;
+    fb.p = p;
+    fb.window = window;
+    fb.max_bits = max_bits;
+
+    long windows = (max_bits + window - 1) / window; // number of w-bit windows in an exponent
+    long digits = (1L << window) - 1;                // non-zero digit values per window
+
+    fb.table.clear();
+    fb.table.resize(windows * digits);
+
+    ZZ base_j = fb.base; // base^(2^(w*j)) for the current window j
+    for (long j = 0; j < windows; j++) {
+        ZZ* row = &fb.table[j * digits];
+
+        row[0] = base_j;
+        for (long d = 1; d < digits; d++)
+            MulMod(row[d], row[d - 1], base_j, p); // base_j^(d+1)
+
+        // Moving to the next window: base_j^(2^w) = (base_j^(2^w - 1)) * base_j
+        MulMod(base_j, row[digits - 1], base_j, p);
+    }
+}
+
+ZZ fixed_base_power(const FixedBase& fb, const ZZ& e) {
+    if (fb.table.empty()) throw runtime_error("Fixed-base table is not initialized!");
+
+    // Negative or too large exponents are not covered by the table
+    if (sign(e) < 0 || NumBits(e) > fb.max_bits)
+        return PowerMod(fb.base, e, fb.p);
+
+    long w = fb.window;
+    long digits = (1L << w) - 1;
+    long nbits = NumBits(e);
+
+    ZZ result(1);
+    for (long j = 0; j * w < nbits; j++) {
+        // Reading the j-th w-bit digit of e
+        long d = 0;
+        for (long b = w - 1; b >= 0; b--)
+            d = (d << 1) | bit(e, j * w + b);
+
+        if (d != 0)
+            MulMod(result, result, fb.table[j * digits + (d - 1)], fb.p);
+    }
+
+    return result;
+}
+
+long fixed_base_table_bytes(const FixedBase& fb) {
+    return (long)fb.table.size() * NumBytes(fb.p);
+}
@@ -0,0 +1,28 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <NTL/ZZ.h>
+#include <vector>
+
+using namespace NTL;
+using namespace std;
+
+// Default window size (in bits) for the table of g built by load_parameters()
+const long DEFAULT_G_WINDOW = 6;
+
+// Precomputed powers of ONE fixed base, so that base^e mod p needs no squarings
+// table[j*(2^w - 1) + (d-1)] = base^(d * 2^(w*j)) mod p,  for window j and digit d = 1 .. 2^w - 1
+struct FixedBase {
+    ZZ base;          // the fixed base (for example g)
+    ZZ p;             // the modulus
+    long window = 0;  // w = number of exponent bits handled by one table lookup
+    long max_bits = 0;// exponents with at most this many bits are served from the table
+    vector<ZZ> table;
+};
+
+// Building the table for base (mod p), for exponents of up to max_bits bits
+void fixed_base_init(FixedBase& fb, const ZZ& base, const ZZ& p, long max_bits, long window);
+
+// Computing base^e mod p using the table (falls back to PowerMod if e is too large)
+ZZ fixed_base_power(const FixedBase& fb, const ZZ& e);
+
+// Approximate memory used by the table in bytes (for reporting the size/time tradeoff)
+long fixed_base_table_bytes(const FixedBase& fb);
@@ -0,0 +1,135 @@
+#include "group.h"
+#include "multiexp.h"
+#include "metrics.h"
+#include <stdexcept>
+
+// Smallest prime factor of (p-1)/(2q) below COFACTOR_SEARCH_LIMIT (see Group::cofactor_prime).
+// The first l that divides is always a prime (its own factors would have divided first).
+static long smallest_cofactor_prime(const ZZ& p, const ZZ& q) {
+    ZZ c = (p - 1) / (2 * q);
+    if (c <= 1) return 0;
+    if (divide(c, 2)) return 2;
+    for (long l = 3; l < COFACTOR_SEARCH_LIMIT; l += 2) {
+        if (divide(c, l)) return l;
+    }
+    return COFACTOR_SEARCH_LIMIT;
+}
+
+Group make_group(const ZZ& p, const ZZ& q, const ZZ& g, long g_window) {
+    if (p <= 2 || q <= 1 || g <= 1 || g >= p)
+        throw runtime_error("Invalid group parameters!");
+
+    Group G;
+    G.p = p;
+    G.q = q;
+    G.g = g;
+
+    // Exponents are always reduced mod q, so the table only needs to cover NumBits(q) bits
+    fixed_base_init(G.g_table, g, p, NumBits(q), g_window);
+
+    // Remembering the mod-q context once, instead of calling ZZ_p::init(q) in every function
+    G.q_ctx = ZZ_pContext(q);
+    G.cofactor_prime = smallest_cofactor_prime(p, q);
+
+    // Fast fixed-width arithmetic mod p when p fits one of the compiled limb counts
+    G.backend = make_power_backend(p);
+
+    return G;
+}
+
+Group make_group(const ZZ& p, const ZZ& q, const ZZ& g, FixedBase g_table) {
+    if (p <= 2 || q <= 1 || g <= 1 || g >= p)
+        throw runtime_error("Invalid group parameters!");
+    if (g_table.p != p || g_table.base != g || g_table.max_bits < NumBits(q) || g_table.table.empty())
+        throw runtime_error("The table of g does not belong to this group!");
+
+    Group G;
+    G.p = p;
+    G.q = q;
+    G.g = g;
+    G.g_table = move(g_table);
+    G.q_ctx = ZZ_pContext(q);
+    G.cofactor_prime = smallest_cofactor_prime(p, q);
+    G.backend = make_power_backend(p);
+
+    return G;
+}
+
+Group make_ec_group(const string& curve_name) {
+    Group G;
+    G.curve = make_ec_curve(curve_name);
+
+    G.p = G.curve->field_prime();
+    G.q = G.curve->order();
+    G.g = G.curve->generator();
+
+    // Shares and Lagrange weights live mod the curve order, exactly as mod q before
+    G.q_ctx = ZZ_pContext(G.q);
+
+    return G;
+}
+
+ZZ group_power_g(const Group& G, const ZZ& e) {
+    TE_COUNT(M_FIXED_BASE_POWER, 1);
+    if (G.curve) return G.curve->power_g(e);
+    return fixed_base_power(G.g_table, e);
+}
+
+ZZ group_power(const Group& G, const ZZ& x, const ZZ& e) {
+    TE_COUNT(M_MODEXP, 1);
+    TE_COUNT(M_MODEXP_BITS, NumBits(e));
+    if (G.curve) return G.curve->power(x, e);
+    if (G.backend) return G.backend->power(x, e);
+    return PowerMod(x, e, G.p);
+}
+
+ZZ group_mul(const Group& G, const ZZ& x, const ZZ& y) {
+    if (G.curve) return G.curve->mul(x, y);
+    return MulMod(x, y, G.p);
+}
+
+ZZ group_multi_power(const Group& G, const vector<ZZ>& xs, const vector<ZZ>& es) {
+    TE_COUNT(M_MULTIEXP, 1);
+    TE_COUNT(M_MULTIEXP_TERMS, xs.size());
+    if (G.curve) return G.curve->multi_power(xs, es);
+
+    // Straus on the fixed-width backend; Pippenger (NTL) for very large committees
+    if (G.backend && xs.size() < PIPPENGER_THRESHOLD)
+        return G.backend->multi_power(xs, es);
+
+    return multi_power(xs, es, G.p);
+}
+
+void group_power(ZZ& out, const Group& G, const ZZ& x, const ZZ& e) {
+    TE_COUNT(M_MODEXP, 1);
+    TE_COUNT(M_MODEXP_BITS, NumBits(e));
+    if (G.curve) out = G.curve->power(x, e);
+    else if (G.backend) G.backend->power(out, x, e);
+    else PowerMod(out, x, e, G.p);
+}
+
+void group_mul(ZZ& out, const Group& G, const ZZ& x, const ZZ& y) {
+    if (G.curve) out = G.curve->mul(x, y);
+    else MulMod(out, x, y, G.p);
+}
+
+void group_multi_power(ZZ& out, const Group& G, const vector<ZZ>& xs, const vector<ZZ>& es,
+                       vector<mp_limb_t>& scratch) {
+    if (G.backend && !G.curve && xs.size() < PIPPENGER_THRESHOLD) {
+        TE_COUNT(M_MULTIEXP, 1);
+        TE_COUNT(M_MULTIEXP_TERMS, xs.size());
+        G.backend->multi_power(out, xs, es, scratch);
+    } else {
+        out = group_multi_power(G, xs, es);
+    }
+}
+
+long group_element_bytes(const Group& G) {
+    if (G.curve) return G.curve->element_bytes();
+    return NumBytes(G.p);
+}
+
+string group_name(const Group& G) {
+    if (G.curve) return G.curve->name();
+    return "modp-" + to_string(NumBits(G.p));
+}
@@ -0,0 +1,85 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <NTL/ZZ.h>
+#include <NTL/ZZ_p.h>
+#include "fixedbase.h"
+#include "montgomery.h"
+#include "ec_group.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace NTL;
+using namespace std;
+
+// One ElGamal parameter set (a "group"): everything the library needs to know about it.
+// It replaces the old global p, q, g, so several groups can be used in one process
+// and from several threads at the same time.
+struct Group {
+    ZZ p;              // prime modulus
+    ZZ q;              // prime order of the subgroup generated by g
+    ZZ g;              // generator
+    FixedBase g_table; // precomputed powers of g (for g^e mod p)
+    ZZ_pContext q_ctx; // NTL context for arithmetic mod q (Shamir shares, Lagrange weights)
+
+    // Smallest prime factor of (p-1)/(2q), found by trial division when the group is built:
+    // 0 if (p-1)/(2q) == 1 (safe prime), COFACTOR_SEARCH_LIMIT if no factor is that small.
+    // It decides how many rounds the batched subgroup check needs (see subgroup.h).
+    long cofactor_prime = 0;
+
+    // Fixed-width Montgomery exponentiation mod p, or nullptr if p does not fit any compiled size
+    shared_ptr<const PowerBackend> backend;
+
+    // Elliptic curve group instead of numbers mod p (nullptr for the prime-field group).
+    // Then q is the curve order, g the encoded base point and p the curve's field prime,
+    // and g_table / backend are not used.
+    shared_ptr<const EcCurve> curve;
+};
+
+// Trial division limit for Group::cofactor_prime
+const long COFACTOR_SEARCH_LIMIT = 1L << 16;
+
+// Building a group from p, q, g (g_window sets the size of the g table)
+// The Montgomery backend is selected automatically when p fits
+Group make_group(const ZZ& p, const ZZ& q, const ZZ& g, long g_window = DEFAULT_G_WINDOW);
+
+// Same, around a table of g that was already built (for example loaded from a group cache, see serialize.h)
+Group make_group(const ZZ& p, const ZZ& q, const ZZ& g, FixedBase g_table);
+
+// Building a group on a prime-order elliptic curve ("P-256", "P-384" or "P-521")
+Group make_ec_group(const string& curve_name);
+
+// ------------------------------------------------------------------
+// Group operations: the same code works on both kinds of group.
+// Elements are ZZ (numbers mod p, or encoded curve points, see ec_group.h)
+// and written multiplicatively, so on a curve "mul" is point addition and "power" is scalar multiplication.
+// ------------------------------------------------------------------
+
+ZZ group_power_g(const Group& G, const ZZ& e);                                      // g^e
+ZZ group_power(const Group& G, const ZZ& x, const ZZ& e);                           // x^e
+ZZ group_mul(const Group& G, const ZZ& x, const ZZ& y);                             // x * y
+ZZ group_multi_power(const Group& G, const vector<ZZ>& xs, const vector<ZZ>& es);   // x_1^e_1 * x_2^e_2 * ...
+
+// The same operations writing into out, whose memory is reused (for the Workspace hot path).
+// On the prime-field group with a Montgomery backend these do not allocate
+// (scratch is the table space for the multi-exponentiation, see Workspace::limbs).
+void group_power(ZZ& out, const Group& G, const ZZ& x, const ZZ& e);
+void group_mul(ZZ& out, const Group& G, const ZZ& x, const ZZ& y);
+void group_multi_power(ZZ& out, const Group& G, const vector<ZZ>& xs, const vector<ZZ>& es,
+                       vector<mp_limb_t>& scratch);
+
+// Bytes needed to store any element (NumBytes(p), or the length of an encoded point)
+long group_element_bytes(const Group& G);
+
+// Short description for printing, like "modp-4093" or "P-256"
+string group_name(const Group& G);
+
+// While this object is alive, ZZ_p arithmetic on the CURRENT thread is mod G.q.
+// The previous modulus of this thread is restored when it goes out of scope.
+// NTL keeps the ZZ_p modulus per thread, so this never disturbs other threads.
+class ModQScope {
+public:
+    explicit ModQScope(const Group& G) : push(G.q_ctx) {}
+
+private:
+    ZZ_pPush push;
+};
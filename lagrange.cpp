@@ -5,11 +5,161 @@ without ever rebuilding that key.
 */
 
 #include "lagrange.h"
+#include "metrics.h"
 #include <NTL/ZZ_p.h>
+#include <algorithm>
+#include <stdexcept>
 
-vector<ZZ> lagrange_weights_at_zero(const vector<long>& indices, const ZZ& q) { // we are reconstructing value at x = 0
-                                                                                // the secret is hidden as f(0)
-	ZZ_p::init(q);   // This line indicates that all math from now on happens modulo q                                               
+/*
+Fast version. For player j the weight is
+
+    λ_j = ∏_{m≠j} (0 - x_m) / (x_j - x_m)  =  ∏_{m≠j} x_m  /  ∏_{m≠j} (x_m - x_j)
+
+** the numerators ∏_{m≠j} x_m come from prefix and suffix products (O(k) multiplications)
+** the denominators are products of SMALL integers (differences of player numbers), so they are
+   multiplied as machine words and only occasionally folded into a ZZ_p
+** all k denominators are inverted together with Montgomery's trick: ONE inversion mod q
+   plus about 3k multiplications, instead of k inversions
+*/
+vector<ZZ> lagrange_weights_at_zero(const vector<long>& indices, const Group& G) {
+    TE_TIME(T_LAGRANGE);
+    ModQScope mod_q(G); // all ZZ_p math below is mod q (on this thread only)
+
+    long k = (long)indices.size();
+    vector<ZZ> w(k);
+    if (k == 0) return w;
+
+    vector<ZZ_p> x(k);
+    for (long j = 0; j < k; j++) x[j] = conv<ZZ_p>(indices[j]);
+
+    // prefix[j] = x_0 * ... * x_{j-1},  suffix[j] = x_j * ... * x_{k-1}
+    vector<ZZ_p> prefix(k + 1), suffix(k + 1);
+    prefix[0] = ZZ_p(1);
+    suffix[k] = ZZ_p(1);
+    for (long j = 0; j < k; j++) prefix[j + 1] = prefix[j] * x[j];
+    for (long j = k - 1; j >= 0; j--) suffix[j] = suffix[j + 1] * x[j];
+
+    // den[j] = ∏_{m≠j} (x_m - x_j)
+    vector<ZZ_p> den(k);
+    for (long j = 0; j < k; j++) {
+        den[j] = ZZ_p(1);
+        long acc = 1; // product of differences that still fits in a machine word
+        for (long m = 0; m < k; m++) {
+            if (m == j) continue;
+
+            long d, next;
+            if (__builtin_sub_overflow(indices[m], indices[j], &d))
+                throw runtime_error("Player index difference does not fit in a long!");
+            if (d == 0) throw runtime_error("Player indices must be distinct!");
+
+            if (__builtin_mul_overflow(acc, d, &next)) { // acc is full: fold it into den[j]
+                den[j] *= conv<ZZ_p>(acc);
+                next = d;
+            }
+            acc = next;
+        }
+        den[j] *= conv<ZZ_p>(acc);
+    }
+
+    // Montgomery's batch inversion: run[j] = den[0] * ... * den[j]
+    vector<ZZ_p> run(k);
+    run[0] = den[0];
+    for (long j = 1; j < k; j++) run[j] = run[j - 1] * den[j];
+
+    if (IsZero(run[k - 1])) throw runtime_error("Lagrange denominator is zero mod q!");
+    ZZ_p inv_all = inv(run[k - 1]); // the only inversion
+    TE_COUNT(M_INVERSIONS, 1);
+
+    for (long j = k - 1; j >= 0; j--) {
+        ZZ_p inv_den = (j == 0) ? inv_all : inv_all * run[j - 1]; // 1 / den[j]
+        if (j > 0) inv_all *= den[j];                               // now 1 / (den[0] * ... * den[j-1])
+
+        w[j] = rep(prefix[j] * suffix[j + 1] * inv_den);
+    }
+
+    return w;
+}
+
+/*
+Workspace version of the function above: the same prefix/suffix products and one batch
+inversion, but on plain ZZs reduced mod q (MulMod into existing numbers) instead of ZZ_p
+vectors, so every temporary is one of the workspace's numbers.
+*/
+void lagrange_weights_at_zero(vector<ZZ>& w, const vector<long>& indices, const Group& G, Workspace& ws) {
+    TE_TIME(T_LAGRANGE);
+    const ZZ& q = G.q;
+    long k = (long)indices.size();
+    if ((long)w.size() != k) w.resize(k);
+    if (k == 0) return;
+
+    ZZ* t = ws.numbers(4 * k + 4);
+    ZZ* prefix = t;               // k + 1 numbers
+    ZZ* suffix = t + (k + 1);     // k + 1 numbers
+    ZZ* den = t + 2 * (k + 1);    // k numbers
+    ZZ* run = den + k;            // k numbers
+    ZZ& x = run[k];               // a player index (or a product of differences) mod q
+    ZZ& inv_all = run[k + 1];
+
+    conv(prefix[0], 1);
+    conv(suffix[k], 1);
+    for (long j = 0; j < k; j++) {
+        conv(x, indices[j]);
+        rem(x, x, q);
+        MulMod(prefix[j + 1], prefix[j], x, q);
+    }
+    for (long j = k - 1; j >= 0; j--) {
+        conv(x, indices[j]);
+        rem(x, x, q);
+        MulMod(suffix[j], suffix[j + 1], x, q);
+    }
+
+    // den[j] = ∏_{m≠j} (x_m - x_j), small differences multiplied as machine words first
+    for (long j = 0; j < k; j++) {
+        conv(den[j], 1);
+        long acc = 1;
+        for (long m = 0; m < k; m++) {
+            if (m == j) continue;
+
+            long d, next;
+            if (__builtin_sub_overflow(indices[m], indices[j], &d))
+                throw runtime_error("Player index difference does not fit in a long!");
+            if (d == 0) throw runtime_error("Player indices must be distinct!");
+
+            if (__builtin_mul_overflow(acc, d, &next)) {
+                conv(x, acc);
+                rem(x, x, q);
+                MulMod(den[j], den[j], x, q);
+                next = d;
+            }
+            acc = next;
+        }
+        conv(x, acc);
+        rem(x, x, q);
+        MulMod(den[j], den[j], x, q);
+    }
+
+    // Montgomery's batch inversion, as above
+    run[0] = den[0];
+    for (long j = 1; j < k; j++) MulMod(run[j], run[j - 1], den[j], q);
+
+    if (IsZero(run[k - 1])) throw runtime_error("Lagrange denominator is zero mod q!");
+    InvMod(inv_all, run[k - 1], q);
+    TE_COUNT(M_INVERSIONS, 1);
+
+    for (long j = k - 1; j >= 0; j--) {
+        if (j == 0) x = inv_all;
+        else MulMod(x, inv_all, run[j - 1], q);           // 1 / den[j]
+        if (j > 0) MulMod(inv_all, inv_all, den[j], q);    // now 1 / (den[0] * ... * den[j-1])
+
+        MulMod(x, x, prefix[j], q);
+        MulMod(w[j], x, suffix[j + 1], q);
+    }
+}
+
+// Reference version (the original k-divisions, O(k^2) loop), kept for testing and benchmarks
+vector<ZZ> lagrange_weights_at_zero_reference(const vector<long>& indices, const Group& G) { // we are reconstructing value at x = 0
+                                                                                               // the secret is hidden as f(0)
+	ModQScope mod_q(G); // This line indicates that all math from now on happens modulo q (on this thread only)
 
     long k = (long)indices.size(); // k = The number of players we are using
     vector<ZZ> w(k);
@@ -31,9 +181,67 @@ vector<ZZ> lagrange_weights_at_zero(const vector<long>& indices, const ZZ& q) {
         }
 
         ZZ_p lambda = num / den;     // lambda = num × (inverse of den mod q)
+        TE_COUNT(M_INVERSIONS, 1);
                                      // lambda is representing a weight (multiplier) for one player.
 		w[j] = rep(lambda);          // Player j gets weight w[j]
     }
 
     return w; // Returning all weights
 }
+
+
+LagrangeCache::LagrangeCache(const Group& G, size_t capacity) : G(G), capacity(capacity) {
+    if (capacity == 0) throw runtime_error("LagrangeCache capacity must be at least 1!");
+}
+
+vector<ZZ> LagrangeCache::weights(const vector<long>& indices) {
+    // The cache key is the SET of players, so {5,1,3} and {1,3,5} share one entry
+    vector<long> key = indices;
+    sort(key.begin(), key.end());
+
+    vector<ZZ> sorted_w;
+    {
+        lock_guard<mutex> lk(m);
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            hit_count++;
+            lru.splice(lru.begin(), lru, it->second.lru_pos); // most recently used goes to the front
+            sorted_w = it->second.w;
+        }
+    }
+
+    if (sorted_w.empty()) {
+        // Computing outside the lock, so other threads can keep using the cache meanwhile
+        sorted_w = lagrange_weights_at_zero(key, G);
+
+        lock_guard<mutex> lk(m);
+        miss_count++;
+        if (entries.find(key) == entries.end()) {
+            lru.push_front(key);
+            entries[key] = Entry{ sorted_w, lru.begin() };
+
+            if (entries.size() > capacity) { // evicting the least recently used subset
+                entries.erase(lru.back());
+                lru.pop_back();
+            }
+        }
+    }
+
+    // Putting the weights back into the caller's order of players
+    vector<ZZ> w(indices.size());
+    for (size_t j = 0; j < indices.size(); j++) {
+        size_t pos = lower_bound(key.begin(), key.end(), indices[j]) - key.begin();
+        w[j] = sorted_w[pos];
+    }
+    return w;
+}
+
+size_t LagrangeCache::hits() const {
+    lock_guard<mutex> lk(m);
+    return hit_count;
+}
+
+size_t LagrangeCache::misses() const {
+    lock_guard<mutex> lk(m);
+    return miss_count;
+}
@@ -1,10 +1,52 @@
 #pragma once // This is used to prevent the same file from being included more than once during compilation
 #include <NTL/ZZ.h>
 #include <vector>
+#include <list>
+#include <map>
+#include <mutex>
+#include "group.h"
+#include "workspace.h"
 
 using namespace NTL;
 using namespace std;
 
 // Given indices like {1,3,5}, compute weights λ_j for interpolation at x=0 (mod q)
 // Because the secret is at point 0
-vector<ZZ> lagrange_weights_at_zero(const vector<long>& indices, const ZZ& q);
+// (uses one modular inversion for all players, see lagrange.cpp)
+vector<ZZ> lagrange_weights_at_zero(const vector<long>& indices, const Group& G);
+
+// Same weights written into w (resized to indices.size()), with all temporaries taken from ws.
+// Once w and ws have been used with this committee size, it does not allocate.
+void lagrange_weights_at_zero(vector<ZZ>& w, const vector<long>& indices, const Group& G, Workspace& ws);
+
+// Same weights, computed with the original O(k^2) loop and k divisions (for testing and benchmarks)
+vector<ZZ> lagrange_weights_at_zero_reference(const vector<long>& indices, const Group& G);
+
+// Remembers the weights of recently used player subsets (bounded, least recently used is evicted).
+// The same few committees decrypt over and over, so most calls become a lookup.
+// Safe to use from several threads. The Group must outlive the cache.
+class LagrangeCache {
+public:
+    explicit LagrangeCache(const Group& G, size_t capacity = 64);
+
+    // Same result as lagrange_weights_at_zero(indices, G), in the order of indices
+    vector<ZZ> weights(const vector<long>& indices);
+
+    size_t hits() const;
+    size_t misses() const;
+
+private:
+    struct Entry {
+        vector<ZZ> w;                       // weights for the sorted subset
+        list<vector<long>>::iterator lru_pos;
+    };
+
+    const Group& G;
+    size_t capacity;
+
+    mutable mutex m;
+    list<vector<long>> lru;                 // sorted subsets, most recently used first
+    map<vector<long>, Entry> entries;       // sorted subset -> weights
+    size_t hit_count = 0;
+    size_t miss_count = 0;
+};
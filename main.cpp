@@ -10,32 +10,40 @@
 #include "threshold.h"
 #include "lagrange.h"
 #include "crypto.h"
+#include "batch.h"
+#include "proofs.h"
+#include "async_combiner.h"
+#include "envelope.h"
+#include "feldman.h"
+#include "encrypt.h"
+#include <chrono>
 
 using namespace std;
 using namespace NTL;
 
-int main() {
+int main(int argc, char** argv) {
 
     // ------------------------------------------------
     // Part 1: Load parameters and basic ElGamal setup
     // ------------------------------------------------
 
-    load_parameters();
+    // The group can be chosen on the command line: ./threshold_elgamal [modp | P-256 | P-384 | P-521]
+    Group G = load_group(argc > 1 ? argv[1] : "modp");
 
-    cout << "Global parameters are loaded successfully!" << endl;
+    cout << "Global parameters are loaded successfully! (group: " << group_name(G) << ")" << endl;
     //cout << "bitlen(p) = " << NumBits(p) << endl;
     //cout << "bitlen(q) = " << NumBits(q) << endl;
 
     // Random secret a in [0, q-1]
-    ZZ a = RandomBnd(q);
+    ZZ a = RandomBnd(G.q);
 
-    // Public key A = g^a mod p
-    ZZ A = PowerMod(g, a, p);
+    // Public key A = g^a mod p (using the precomputed table of g)
+    ZZ A = group_power_g(G, a);
 
     cout << "Generated a random secret a and public key A = g^a mod p." << endl;
 
     // Checking PowerMod function with ZZ (test only)
-    ZZ test = PowerMod(g, ZZ(12345678), p);
+    ZZ test = group_power(G, G.g, ZZ(12345678));
 
     // -----------------------------------------------------
     // Part 2: Shamir secret sharing (Choosing t = 2, n = 5)
@@ -47,7 +55,9 @@ int main() {
          << " (i.e., we need t+1 = " << (t+1) << " shares), n = " << n << " players." << endl;
 
     // Splitting secret a into n shares using threshold t
-    auto shares = shamir_split(a, t, n, q); // Using auto to let the compiler figure out the type for me
+    // (also getting the public verification keys V_i = g^(a_i), used to check partial decryptions in Part 10)
+    vector<ZZ> vkeys;
+    auto shares = shamir_split(a, t, n, G, vkeys); // Using auto to let the compiler figure out the type for me
 
    cout << endl << "Shares are being created for each player!" << endl;
 	for (auto& s : shares) {
@@ -61,7 +71,7 @@ int main() {
     /*
     /*********************************************************
     // Reconstruct (test only)
-    ZZ recovered = shamir_reconstruct(subset, q);
+    ZZ recovered = shamir_reconstruct(subset, G);
 
     cout << "Recovered a = " << recovered << endl;
     cout << (recovered == a ? "SUCCESS" : "FAILURE") << endl;
@@ -72,15 +82,15 @@ int main() {
     // ----- Part 3: Partial decryption test -----
     //--------------------------------------------
 
-    // Choose random b and compute B = g^b mod p
-    ZZ b = RandomBnd(q);
-    ZZ B = PowerMod(g, b, p);
+    // Choose random b and compute B = g^b mod p (using the precomputed table of g)
+    ZZ b = RandomBnd(G.q);
+    ZZ B = group_power_g(G, b);
 
     cout << endl << "Testing partial decryptions:" << endl;
 
     // Each player computes a partial decryption D_i = B^(a_i) mod p
     for (auto& s : shares) {
-        ZZ Di = partial_decrypt(B, s.value, p);
+        ZZ Di = partial_decrypt(B, s.value, G);
         cout << "Player " << s.index << " computed D_" << s.index << endl;
     }
 
@@ -94,17 +104,34 @@ int main() {
     // Building partial decryptions for the selected players: D_i = B^(a_i)
     vector<ZZ> partials;
     for (auto& sh : subset) {
-        partials.push_back(partial_decrypt(B, sh.value, p));
+        partials.push_back(partial_decrypt(B, sh.value, G));
     }
 
     // Computing Lagrange weights at x=0 (mod q), because the secret is at point 0
-    vector<ZZ> weights = lagrange_weights_at_zero(idx, q);
+    vector<ZZ> weights = lagrange_weights_at_zero(idx, G);
+    cout << "lagrange_weights_at_zero == reference ? "
+         << (lagrange_weights_at_zero_reference(idx, G) == weights ? "SUCCESS" : "FAILURE") << endl;
 
     // Combining partial decryptions using weights to get S_threshold
-    ZZ S_threshold = combine_partials(partials, weights, p);
+    // (one multi-exponentiation instead of one PowerMod per player)
+    ZZ S_threshold = combine_partials_multiexp(partials, weights, G);
+
+    // The reference combine (one PowerMod per player) must give the same value
+    cout << "combine_partials == combine_partials_multiexp ? "
+         << (combine_partials(partials, weights, G) == S_threshold ? "SUCCESS" : "FAILURE") << endl;
+
+    // Pre-weighted mode: the committee is known in advance, so every player returns B^(λ_i * a_i)
+    // and the combiner only multiplies (the tag on each partial tells combine_partials which mode it is)
+    vector<Partial> weighted;
+    for (auto& sh : subset) {
+        weighted.push_back(partial_decrypt_weighted(B, sh, idx, G));
+    }
+    cout << "pre-weighted combine == combine_partials_multiexp ? "
+         << (combine_partials(weighted, G) == S_threshold ? "SUCCESS" : "FAILURE") << endl;
 
     // TEST ONLY PART: direct compute S_direct = B^a mod p
-    ZZ S_direct = PowerMod(B, a, p);
+    // (for the prime-field group with NTL's PowerMod, while the threshold path above used the group's Montgomery backend)
+    ZZ S_direct = G.curve ? group_power(G, B, a) : PowerMod(B, a, G.p);
 
     cout << endl << "S_direct == S_threshold ? " << (S_direct == S_threshold ? "SUCCESS" : "FAILURE") << endl;
 
@@ -130,5 +157,153 @@ int main() {
     string recovered(dec.begin(), dec.end());
     cout << endl << "Recovered message: " << endl << "------------------" << endl << recovered << endl << endl;
 
+    // ---------------------------------------------------
+    // Part 6: Batch threshold decryption on all cores
+    // ---------------------------------------------------
+
+    // Encrypting a few messages to the public key A: B_j = g^(b_j), key_j = SHA256(A^(b_j))
+    // (from the 2nd message on, the sender has a fixed-base table for A, see encrypt.h)
+    Encryptor sender(G);
+    vector<Ciphertext> batch;
+    vector<string> batch_msgs;
+    for (int j = 0; j < 8; j++) {
+        string mj = "Batch message #" + to_string(j);
+        batch.push_back(sender.encrypt(A, vector<unsigned char>(mj.begin(), mj.end())));
+        batch_msgs.push_back(mj);
+    }
+
+    // The same 3 players decrypt the whole batch (weights computed once, work spread over the pool)
+    ThreadPool pool;
+    auto batch_pt = threshold_decrypt_batch(batch, subset, G, pool);
+
+    bool batch_ok = true;
+    for (size_t j = 0; j < batch.size(); j++)
+        batch_ok = batch_ok && string(batch_pt[j].begin(), batch_pt[j].end()) == batch_msgs[j];
+
+    cout << "Batch decryption of " << batch.size() << " ciphertexts on " << pool.size() << " threads ? "
+         << (batch_ok ? "SUCCESS" : "FAILURE") << endl;
+
+    // A B outside the subgroup of order q is rejected before any share is applied to it
+    vector<Ciphertext> tampered = batch;
+    tampered[3].B = G.p - 1;
+    bool rejected = false;
+    try {
+        threshold_decrypt_batch(tampered, subset, G, pool);
+    } catch (const exception& e) {
+        rejected = string(e.what()).find("ciphertext 3: B is not in the subgroup") != string::npos;
+    }
+    cout << "Batch decryption rejects a B outside the subgroup ? " << (rejected ? "SUCCESS" : "FAILURE") << endl;
+
+    // ---------------------------------------------------
+    // Part 7: Asynchronous combine (whoever answers first)
+    // ---------------------------------------------------
+
+    // All 5 players are asked; they answer after different delays (player 5 is very slow).
+    // The combiner uses the first 3 answers and does not wait for the others.
+    vector<long> latency_ms = { 120, 10, 60, 30, 400 };
+    AsyncCombiner combiner(B, t, n, G);
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> players = simulate_players(combiner, B, shares, latency_ms, G);
+
+    ZZ S_async = combiner.result().get();
+    auto waited = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+
+    cout << "Async combine used players";
+    for (long i : combiner.used_players()) cout << " " << i;
+    cout << " and did not wait for the slowest ? "
+         << (S_async == S_direct && waited < latency_ms[4] ? "SUCCESS" : "FAILURE") << endl;
+
+    for (auto& th : players) th.join(); // the late players still finish (their partials are ignored)
+
+    // ---------------------------------------------------
+    // Part 8: Batch envelope (one threshold round for many messages)
+    // ---------------------------------------------------
+
+    // 1000 log records under ONE encapsulation B; each record has its own HKDF-derived key and nonce
+    vector<vector<unsigned char>> records;
+    for (int j = 0; j < 1000; j++) {
+        string line = "log record #" + to_string(j);
+        records.push_back(vector<unsigned char>(line.begin(), line.end()));
+    }
+    BatchEnvelope env = batch_encrypt(A, records, G);
+
+    // The committee does a single round of partial decryptions for env.B ...
+    vector<ZZ> env_partials;
+    for (auto& sh : subset) env_partials.push_back(partial_decrypt(env.B, sh.value, G));
+    BatchKey env_key(combine_partials_multiexp(env_partials, weights, G), env.B, G);
+
+    // ... and that opens any record directly (random access)
+    bool env_ok = batch_open_record(env_key, env, 777) == records[777] && batch_open_record(env_key, env, 0) == records[0];
+    cout << "Batch envelope: 1 threshold decryption opens records 0 and 777 of " << records.size() << " ? "
+         << (env_ok ? "SUCCESS" : "FAILURE") << endl;
+
+    // ---------------------------------------------------
+    // Part 9: Verifiable secret sharing (Feldman commitments)
+    // ---------------------------------------------------
+
+    // A new dealing for the same secret: shares plus public commitments C_j = g^(coef_j)
+    vector<ZZ> commitments;
+    vector<Share> dealt = feldman_split(a, t, n, G, commitments);
+
+    cout << endl << "Feldman commitments valid and C_0 == public key ? "
+         << (feldman_check_commitments(commitments, G) && commitments[0] == A ? "SUCCESS" : "FAILURE") << endl;
+    cout << "All " << dealt.size() << " shares match the commitments (one batch check) ? "
+         << (feldman_verify_shares_batch(dealt, commitments, G) ? "SUCCESS" : "FAILURE") << endl;
+
+    // A dealer that sends player 4 a wrong share is caught
+    dealt[3].value = (dealt[3].value + 1) % G.q;
+    vector<long> bad_shares = feldman_find_bad_shares(dealt, commitments, G);
+    cout << "Wrong share identified (player 4) ? "
+         << (bad_shares.size() == 1 && bad_shares[0] == 4 ? "SUCCESS" : "FAILURE") << endl;
+
+    if (G.curve) {
+        cout << "(Proofs of partial decryption are only implemented for the prime-field group.)" << endl << endl;
+        return 0;
+    }
+
+    // ---------------------------------------------------
+    // Part 10: Verifiable partial decryptions
+    // ---------------------------------------------------
+
+    // Every player sends D_i = B^(a_i) with a Chaum-Pedersen proof that it used the same a_i as in V_i
+    vector<ZZ> batch_B;
+    vector<vector<VerifiablePartial>> proved(batch.size());
+    for (size_t j = 0; j < batch.size(); j++) {
+        batch_B.push_back(batch[j].B);
+        for (auto& sh : subset)
+            proved[j].push_back(partial_decrypt_with_proof(batch[j].B, sh, vkeys[sh.index - 1], G));
+    }
+
+    // All proofs of the whole batch are checked together
+    cout << "All " << batch.size() * subset.size() << " partial decryption proofs valid ? "
+         << (verify_partials_batch(batch_B, proved, vkeys, G) ? "SUCCESS" : "FAILURE") << endl;
+
+    // A faulty player: player 3 sends a wrong D for ciphertext 5, and gets caught
+    proved[5][1].D = group_mul(G, proved[5][1].D, G.g);
+    auto faults = find_bad_partials(batch_B, proved, vkeys, G);
+    bool caught = faults.size() == 1 && faults[0].ciphertext == 5 && faults[0].index == 3;
+    cout << "Faulty partial identified (player 3, ciphertext 5) ? " << (caught ? "SUCCESS" : "FAILURE") << endl;
+
+    // ---------------------------------------------------
+    // Part 11: Multi-recipient encryption (one b for all recipients)
+    // ---------------------------------------------------
+
+    // Recipients: our committee (public key A) and a second key holder (a2, A2 = g^a2)
+    ZZ a2 = RandomBnd(G.q);
+    ZZ A2 = group_power_g(G, a2);
+    string shared_msg = "One message for two recipients";
+    MultiCiphertext multi = sender.encrypt_multi({ A, A2 }, vector<unsigned char>(shared_msg.begin(), shared_msg.end()));
+
+    // The committee threshold-decrypts multi.B as usual, the second recipient uses a2 directly
+    vector<ZZ> multi_partials;
+    for (auto& sh : subset) multi_partials.push_back(partial_decrypt(multi.B, sh.value, G));
+    auto pt_committee = open_multi(combine_partials_multiexp(multi_partials, weights, G), multi, 0);
+    auto pt_second = open_multi(group_power(G, multi.B, a2), multi, 1);
+
+    bool multi_ok = string(pt_committee.begin(), pt_committee.end()) == shared_msg
+                    && string(pt_second.begin(), pt_second.end()) == shared_msg;
+    cout << "Multi-recipient encryption opened by both recipients ? " << (multi_ok ? "SUCCESS" : "FAILURE") << endl << endl;
+
     return 0;
 }
@@ -0,0 +1,193 @@
+/*
+This file keeps the per-thread counters and histograms and exports them (see metrics.h).
+*/
+
+#include "metrics.h"
+#include "serialize.h"
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+static const char* METRIC_NAMES[METRIC_COUNT] = {
+    "modexp", "modexp_bits", "fixed_base_power", "multiexp", "multiexp_terms", "inversions",
+    "aead_encrypt_bytes", "aead_decrypt_bytes", "gcm_tag_failures", "workspace_grows"
+};
+
+static const char* TIMER_NAMES[TIMER_COUNT] = {
+    "partial_decrypt", "partial_decrypt_many", "combine", "lagrange", "verify_proofs",
+    "aead_encrypt", "aead_decrypt", "batch_decrypt"
+};
+
+const char* metric_name(Metric m) { return METRIC_NAMES[m]; }
+const char* timer_name(Timer t) { return TIMER_NAMES[t]; }
+
+#ifndef TE_NO_METRICS
+
+//-----------------------------------------------------
+//------------- Per-thread blocks ---------------------
+//-----------------------------------------------------
+
+/*
+Only the owning thread writes its block, so an update is a relaxed load and store
+(no locked instruction). The values are atomics only so that a snapshot taken
+by another thread reads them without a data race.
+*/
+struct ThreadBlock {
+    atomic<uint64_t> counters[METRIC_COUNT];
+    atomic<uint64_t> timer_count[TIMER_COUNT];
+    atomic<uint64_t> timer_ns[TIMER_COUNT];
+    atomic<uint64_t> buckets[TIMER_COUNT][HISTOGRAM_BUCKETS];
+
+    ThreadBlock();
+    ~ThreadBlock();
+};
+
+static mutex registry_mutex;
+static std::set<ThreadBlock*>& live_blocks() { static std::set<ThreadBlock*> s; return s; }
+static MetricsSnapshot& retired() { static MetricsSnapshot s; return s; } // threads that have exited
+
+static void bump(atomic<uint64_t>& x, uint64_t n) {
+    x.store(x.load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+// Adding a block to a snapshot
+static void add_block(MetricsSnapshot& s, const ThreadBlock& b) {
+    for (int m = 0; m < METRIC_COUNT; m++) s.counters[m] += b.counters[m].load(memory_order_relaxed);
+    for (int t = 0; t < TIMER_COUNT; t++) {
+        s.timers[t].count += b.timer_count[t].load(memory_order_relaxed);
+        s.timers[t].total_ns += b.timer_ns[t].load(memory_order_relaxed);
+        for (int i = 0; i < HISTOGRAM_BUCKETS; i++) s.timers[t].buckets[i] += b.buckets[t][i].load(memory_order_relaxed);
+    }
+}
+
+static void clear_block(ThreadBlock& b) {
+    for (auto& c : b.counters) c.store(0, memory_order_relaxed);
+    for (int t = 0; t < TIMER_COUNT; t++) {
+        b.timer_count[t].store(0, memory_order_relaxed);
+        b.timer_ns[t].store(0, memory_order_relaxed);
+        for (auto& x : b.buckets[t]) x.store(0, memory_order_relaxed);
+    }
+}
+
+ThreadBlock::ThreadBlock() {
+    clear_block(*this);
+    lock_guard<mutex> lock(registry_mutex);
+    live_blocks().insert(this);
+}
+
+ThreadBlock::~ThreadBlock() {
+    // The thread is exiting: its counts move to the retired totals so they are not lost
+    lock_guard<mutex> lock(registry_mutex);
+    add_block(retired(), *this);
+    live_blocks().erase(this);
+}
+
+static ThreadBlock& this_thread_block() {
+    thread_local ThreadBlock block;
+    return block;
+}
+
+void metrics_add(Metric m, uint64_t n) {
+    bump(this_thread_block().counters[m], n);
+}
+
+void metrics_record(Timer t, uint64_t ns) {
+    ThreadBlock& b = this_thread_block();
+    bump(b.timer_count[t], 1);
+    bump(b.timer_ns[t], ns);
+
+    // Bucket: the first b with ns < 2^(b + 10)
+    int bucket = 0;
+    for (uint64_t limit = 1ULL << 10; bucket < HISTOGRAM_BUCKETS - 1 && ns >= limit; limit <<= 1) bucket++;
+    bump(b.buckets[t][bucket], 1);
+}
+
+MetricsSnapshot metrics_snapshot() {
+    lock_guard<mutex> lock(registry_mutex);
+    MetricsSnapshot s = retired();
+    for (ThreadBlock* b : live_blocks()) add_block(s, *b);
+    s.enabled = true;
+    return s;
+}
+
+void metrics_reset() {
+    lock_guard<mutex> lock(registry_mutex);
+    retired() = MetricsSnapshot();
+    for (ThreadBlock* b : live_blocks()) clear_block(*b);
+}
+
+#else
+
+MetricsSnapshot metrics_snapshot() { return MetricsSnapshot(); }
+void metrics_reset() {}
+
+#endif
+
+//-----------------------------------------------------
+//------------- Export --------------------------------
+//-----------------------------------------------------
+
+// Upper bound of histogram bucket i in ns (the last bucket has none)
+static uint64_t bucket_limit_ns(int i) { return 1ULL << (i + 10); }
+
+string metrics_json(const MetricsSnapshot& s) {
+    ostringstream out;
+    out << "{\n  \"enabled\": " << (s.enabled ? "true" : "false") << ",\n  \"counters\": {";
+    for (int m = 0; m < METRIC_COUNT; m++)
+        out << (m ? "," : "") << "\n    \"" << METRIC_NAMES[m] << "\": " << s.counters[m];
+    out << "\n  },\n  \"timers\": {";
+
+    for (int t = 0; t < TIMER_COUNT; t++) {
+        const TimerStats& ts = s.timers[t];
+        out << (t ? "," : "") << "\n    \"" << TIMER_NAMES[t] << "\": {\"count\": " << ts.count
+            << ", \"total_ns\": " << ts.total_ns << ", \"buckets\": [";
+        for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            out << (i ? ", " : "") << "{\"le_ns\": ";
+            if (i == HISTOGRAM_BUCKETS - 1) out << "null";
+            else out << bucket_limit_ns(i);
+            out << ", \"count\": " << ts.buckets[i] << "}";
+        }
+        out << "]}";
+    }
+    out << "\n  }\n}\n";
+    return out.str();
+}
+
+string metrics_prometheus(const MetricsSnapshot& s) {
+    ostringstream out;
+    out << "# HELP te_metrics_enabled 1 if the library was built with metrics\n"
+        << "# TYPE te_metrics_enabled gauge\n"
+        << "te_metrics_enabled " << (s.enabled ? 1 : 0) << "\n";
+
+    for (int m = 0; m < METRIC_COUNT; m++) {
+        out << "# TYPE te_" << METRIC_NAMES[m] << "_total counter\n"
+            << "te_" << METRIC_NAMES[m] << "_total " << s.counters[m] << "\n";
+    }
+
+    // Histograms in seconds, with cumulative buckets as Prometheus expects
+    for (int t = 0; t < TIMER_COUNT; t++) {
+        const TimerStats& ts = s.timers[t];
+        string name = string("te_") + TIMER_NAMES[t] + "_seconds";
+        out << "# TYPE " << name << " histogram\n";
+
+        uint64_t cumulative = 0;
+        for (int i = 0; i < HISTOGRAM_BUCKETS - 1; i++) {
+            cumulative += ts.buckets[i];
+            out << name << "_bucket{le=\"" << (double)bucket_limit_ns(i) / 1e9 << "\"} " << cumulative << "\n";
+        }
+        out << name << "_bucket{le=\"+Inf\"} " << ts.count << "\n"
+            << name << "_sum " << (double)ts.total_ns / 1e9 << "\n"
+            << name << "_count " << ts.count << "\n";
+    }
+    return out.str();
+}
+
+void metrics_write_file(const string& path, MetricsFormat format) {
+    MetricsSnapshot s = metrics_snapshot();
+    string text = format == METRICS_JSON ? metrics_json(s) : metrics_prometheus(s);
+
+    // A uniquely named temporary file, so several exporters of the same path cannot collide
+    replace_file(path, [&](const ByteOut& out) { out((const unsigned char*)text.data(), text.size()); });
+}
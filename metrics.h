@@ -0,0 +1,112 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+Counters and latency histograms for the stages of the pipeline.
+
+Every thread counts into its own block (no locks and no shared cache lines on the hot path);
+a snapshot adds up the blocks of all threads, including threads that have already exited.
+
+    TE_COUNT(M_MODEXP, 1);            // adds to a counter
+    TE_TIME(T_PARTIAL_DECRYPT);       // times the rest of the current scope into a histogram
+
+Building with -DTE_NO_METRICS (make METRICS=0) turns both macros into nothing.
+The snapshot / export functions still exist then and report everything as 0, with "enabled": false.
+*/
+
+enum Metric {
+    M_MODEXP,              // exponentiations x^e (mod p or on a curve), SIMD lanes included
+    M_MODEXP_BITS,         // total bits of their exponents
+    M_FIXED_BASE_POWER,    // g^e with the precomputed table
+    M_MULTIEXP,            // multi-exponentiations
+    M_MULTIEXP_TERMS,      // total number of bases in them
+    M_INVERSIONS,          // modular inversions (batch inversions count once)
+    M_AEAD_ENCRYPT_BYTES,  // plaintext bytes encrypted with AES-256-GCM
+    M_AEAD_DECRYPT_BYTES,  // ciphertext bytes given to AES-256-GCM decryption
+    M_GCM_TAG_FAILURES,    // decryptions rejected by the GCM tag (wrong key or modified data)
+    M_WORKSPACE_GROWS,     // allocations made by a Workspace (should stay flat once it is warm)
+    METRIC_COUNT
+};
+
+enum Timer {
+    T_PARTIAL_DECRYPT,     // one partial decryption
+    T_PARTIAL_DECRYPT_MANY,// one player's partials for a batch of ciphertexts
+    T_COMBINE,             // combining partials into S
+    T_LAGRANGE,            // Lagrange weights of a committee
+    T_VERIFY_PROOFS,       // batch check of partial decryption proofs
+    T_AEAD_ENCRYPT,        // aes256gcm_encrypt
+    T_AEAD_DECRYPT,        // aes256gcm_decrypt
+    T_BATCH_DECRYPT,       // a whole threshold_decrypt_batch call
+    TIMER_COUNT
+};
+
+// Histogram bucket b counts durations below 2^(b + 10) ns (about 1 µs, 2 µs, ... 17 s); the last bucket is everything longer
+const int HISTOGRAM_BUCKETS = 26;
+
+struct TimerStats {
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t buckets[HISTOGRAM_BUCKETS] = {};
+};
+
+struct MetricsSnapshot {
+    bool enabled = false;
+    uint64_t counters[METRIC_COUNT] = {};
+    TimerStats timers[TIMER_COUNT];
+};
+
+const char* metric_name(Metric m); // for example "modexp"
+const char* timer_name(Timer t);   // for example "partial_decrypt"
+
+// Adding up all threads (threads that are counting at the same time may be slightly ahead of it)
+MetricsSnapshot metrics_snapshot();
+
+// Setting everything back to 0 (meant for tests and benchmarks, while no other thread is counting)
+void metrics_reset();
+
+string metrics_json(const MetricsSnapshot& s);
+string metrics_prometheus(const MetricsSnapshot& s); // Prometheus text format, names start with "te_"
+
+// Writing a snapshot to a local file, through a temporary file and a rename, so a collector
+// reading the file (for example node_exporter's textfile collector) never sees half of it
+// (replace_file in serialize.h: the temporary name is unique, so several exporters may share a path)
+enum MetricsFormat { METRICS_JSON, METRICS_PROMETHEUS };
+void metrics_write_file(const string& path, MetricsFormat format);
+
+#ifndef TE_NO_METRICS
+
+void metrics_add(Metric m, uint64_t n);
+void metrics_record(Timer t, uint64_t ns);
+
+// Records the time from its construction to the end of the scope
+class MetricTimer {
+public:
+    explicit MetricTimer(Timer t) : timer(t), start(chrono::steady_clock::now()) {}
+    ~MetricTimer() {
+        metrics_record(timer, (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+    }
+
+    MetricTimer(const MetricTimer&) = delete;
+    MetricTimer& operator=(const MetricTimer&) = delete;
+
+private:
+    Timer timer;
+    chrono::steady_clock::time_point start;
+};
+
+#define TE_METRIC_CONCAT2(a, b) a##b
+#define TE_METRIC_CONCAT(a, b) TE_METRIC_CONCAT2(a, b)
+#define TE_COUNT(metric, n) metrics_add((metric), (uint64_t)(n))
+#define TE_TIME(timer) MetricTimer TE_METRIC_CONCAT(te_metric_timer_, __LINE__)(timer)
+
+#else
+
+#define TE_COUNT(metric, n) ((void)0)
+#define TE_TIME(timer) ((void)0)
+
+#endif
@@ -0,0 +1,22 @@
+/*
+This file picks a fixed-width Montgomery backend for a modulus.
+The limb counts below are compiled in; a modulus gets the smallest one it fits in.
+Anything bigger (or an even modulus) gets nullptr, and NTL is used instead.
+*/
+
+#include "montgomery.h"
+
+shared_ptr<const PowerBackend> make_power_backend(const ZZ& p) {
+    if (!IsOdd(p) || p <= 1) return nullptr;
+
+    long limbs = (NumBits(p) + 63) / 64;
+
+    if (limbs <= 16)  return make_shared<MontgomeryBackend<16>>(p);  // up to 1024 bits
+    if (limbs <= 32)  return make_shared<MontgomeryBackend<32>>(p);  // up to 2048 bits
+    if (limbs <= 48)  return make_shared<MontgomeryBackend<48>>(p);  // up to 3072 bits
+    if (limbs <= 64)  return make_shared<MontgomeryBackend<64>>(p);  // up to 4096 bits (the shipped group)
+    if (limbs <= 72)  return make_shared<MontgomeryBackend<72>>(p);  // up to 4608 bits
+    if (limbs <= 128) return make_shared<MontgomeryBackend<128>>(p); // up to 8192 bits
+
+    return nullptr;
+}
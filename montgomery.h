@@ -0,0 +1,269 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <NTL/ZZ.h>
+#include <gmp.h>
+#include <array>
+#include <type_traits>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace NTL;
+using namespace std;
+
+// Our limbs are GMP limbs (NTL's ZZ is built on GMP), and the code below assumes 64-bit limbs
+static_assert(sizeof(mp_limb_t) == 8, "Montgomery backend expects 64-bit GMP limbs");
+
+// A modular exponentiation engine for one fixed modulus p.
+// The Group picks the fastest one that supports its p (see make_power_backend).
+class PowerBackend {
+public:
+    virtual ~PowerBackend() {}
+
+    virtual const char* name() const = 0;
+
+    // base^e mod p
+    virtual ZZ power(const ZZ& base, const ZZ& e) const = 0;
+
+    // ∏ bases[i]^exps[i] mod p (exponents must be non-negative)
+    virtual ZZ multi_power(const vector<ZZ>& bases, const vector<ZZ>& exps) const = 0;
+
+    // The same two, writing into out (its memory is reused). The table of multi_power is kept
+    // in scratch, which only grows, so repeated calls do not allocate (see workspace.h).
+    virtual void power(ZZ& out, const ZZ& base, const ZZ& e) const = 0;
+    virtual void multi_power(ZZ& out, const vector<ZZ>& bases, const vector<ZZ>& exps,
+                             vector<mp_limb_t>& scratch) const = 0;
+};
+
+// Montgomery arithmetic with a modulus of at most N limbs (64*N bits).
+// Numbers are fixed-size arrays on the stack, so a multiplication never allocates.
+template<size_t N>
+class MontgomeryBackend : public PowerBackend {
+public:
+    typedef array<mp_limb_t, N> Limbs;
+    static_assert(sizeof(Limbs) == N * sizeof(mp_limb_t) && is_standard_layout<Limbs>::value,
+                  "Limbs must be laid out like a plain array (multi_power keeps them in a limb vector)");
+
+    explicit MontgomeryBackend(const ZZ& p);
+
+    const char* name() const override { return label.c_str(); }
+    ZZ power(const ZZ& base, const ZZ& e) const override;
+    ZZ multi_power(const vector<ZZ>& bases, const vector<ZZ>& exps) const override;
+    void power(ZZ& out, const ZZ& base, const ZZ& e) const override;
+    void multi_power(ZZ& out, const vector<ZZ>& bases, const vector<ZZ>& exps,
+                     vector<mp_limb_t>& scratch) const override;
+
+    // Montgomery-domain operations (a value x is stored as x*R mod p, R = 2^(64N))
+    void to_mont(Limbs& out, const ZZ& x) const;    // x*R mod p
+    void from_mont(ZZ& out, const Limbs& a) const;  // a/R mod p
+    void mul(Limbs& out, const Limbs& a, const Limbs& b) const;
+    void sqr(Limbs& out, const Limbs& a) const;
+    const Limbs& one() const { return one_m; }      // 1 in Montgomery form (R mod p)
+
+private:
+    ZZ p_zz;
+    Limbs p_limbs;
+    Limbs r2;          // R^2 mod p, used to enter the Montgomery domain
+    Limbs one_m;       // R mod p
+    mp_limb_t n0inv;   // -p^(-1) mod 2^64
+    string label;
+
+    void redc(Limbs& out, mp_limb_t* t) const; // out = t / R mod p, t has 2N limbs (it is overwritten)
+    static void load(Limbs& out, const ZZ& x); // copying the limbs of 0 <= x < 2^(64N)
+};
+
+// Picking a Montgomery backend whose limb count fits p, or nullptr if none does
+// (then the callers keep using NTL's PowerMod)
+shared_ptr<const PowerBackend> make_power_backend(const ZZ& p);
+
+
+//**********************************************************
+//********** Template definitions (MontgomeryBackend) ******
+//**********************************************************
+
+template<size_t N>
+MontgomeryBackend<N>::MontgomeryBackend(const ZZ& p) : p_zz(p) {
+    if (!IsOdd(p) || p <= 1 || NumBits(p) > (long)(64 * N))
+        throw runtime_error("Montgomery backend needs an odd modulus that fits in the limb count!");
+
+    load(p_limbs, p);
+
+    // Newton iteration for p^(-1) mod 2^64 (each step doubles the number of correct bits)
+    mp_limb_t inv = p_limbs[0];
+    for (int i = 0; i < 6; i++) inv *= 2 - p_limbs[0] * inv;
+    n0inv = -inv;
+
+    ZZ R = ZZ(1) << (long)(64 * N);
+    load(one_m, R % p);
+    load(r2, (R * R) % p);
+
+    label = "montgomery-" + to_string(64 * N);
+}
+
+template<size_t N>
+void MontgomeryBackend<N>::load(Limbs& out, const ZZ& x) {
+    out.fill(0);
+    long n = x.size();
+    if (n > 0) {
+        const mp_limb_t* src = (const mp_limb_t*)ZZ_limbs_get(x);
+        for (long i = 0; i < n && i < (long)N; i++) out[i] = src[i];
+    }
+}
+
+template<size_t N>
+void MontgomeryBackend<N>::redc(Limbs& out, mp_limb_t* t) const {
+    // Clearing one low limb per step by adding a multiple of p.
+    // The carry out of step i belongs at position i+N; it is parked in t[i] (which is now zero).
+    for (size_t i = 0; i < N; i++) {
+        mp_limb_t m = t[i] * n0inv;
+        t[i] = mpn_addmul_1(t + i, p_limbs.data(), N, m);
+    }
+
+    mp_limb_t cy = mpn_add_n(out.data(), t + N, t, N);
+
+    // The result is below 2p, so at most one subtraction is needed
+    if (cy || mpn_cmp(out.data(), p_limbs.data(), N) >= 0)
+        mpn_sub_n(out.data(), out.data(), p_limbs.data(), N);
+}
+
+template<size_t N>
+void MontgomeryBackend<N>::mul(Limbs& out, const Limbs& a, const Limbs& b) const {
+    mp_limb_t t[2 * N];
+    if (&a == &b) mpn_sqr(t, a.data(), N);
+    else mpn_mul_n(t, a.data(), b.data(), N);
+    redc(out, t);
+}
+
+template<size_t N>
+void MontgomeryBackend<N>::sqr(Limbs& out, const Limbs& a) const {
+    mp_limb_t t[2 * N];
+    mpn_sqr(t, a.data(), N);
+    redc(out, t);
+}
+
+template<size_t N>
+void MontgomeryBackend<N>::to_mont(Limbs& out, const ZZ& x) const {
+    Limbs a;
+    if (sign(x) < 0 || x >= p_zz) load(a, x % p_zz);
+    else load(a, x);
+    mul(out, a, r2); // (x * R^2) / R = x*R
+}
+
+template<size_t N>
+void MontgomeryBackend<N>::from_mont(ZZ& out, const Limbs& a) const {
+    mp_limb_t t[2 * N];
+    for (size_t i = 0; i < N; i++) { t[i] = a[i]; t[N + i] = 0; }
+
+    Limbs r;
+    redc(r, t);
+    ZZ_limbs_set(out, (const ZZ_limb_t*)r.data(), (long)N);
+}
+
+template<size_t N>
+ZZ MontgomeryBackend<N>::power(const ZZ& base, const ZZ& e) const {
+    ZZ result;
+    power(result, base, e);
+    return result;
+}
+
+template<size_t N>
+void MontgomeryBackend<N>::power(ZZ& out, const ZZ& base, const ZZ& e) const {
+    if (sign(e) < 0) { PowerMod(out, base % p_zz, e, p_zz); return; } // needs an inverse, left to NTL
+
+    long nbits = NumBits(e);
+    if (nbits == 0) { conv(out, 1); return; }
+
+    // Sliding window: table of the odd powers x, x^3, x^5, ..., x^(2^w - 1)
+    const long w = nbits > 256 ? 5 : 4;
+    array<Limbs, 16> odd;
+    Limbs x2, acc;
+
+    to_mont(odd[0], base);
+    sqr(x2, odd[0]);
+    for (long i = 1; i < (1L << (w - 1)); i++) mul(odd[i], odd[i - 1], x2);
+
+    bool started = false;
+    long i = nbits - 1;
+    while (i >= 0) {
+        if (!bit(e, i)) {
+            if (started) sqr(acc, acc);
+            i--;
+            continue;
+        }
+
+        // Longest window i..l (at most w bits) that ends with a 1 bit
+        long l = max(i - w + 1, 0L);
+        while (!bit(e, l)) l++;
+
+        long val = 0;
+        for (long b = i; b >= l; b--) val = (val << 1) | bit(e, b);
+
+        if (!started) {
+            acc = odd[(val - 1) / 2];
+            started = true;
+        } else {
+            for (long s = 0; s < i - l + 1; s++) sqr(acc, acc);
+            mul(acc, acc, odd[(val - 1) / 2]);
+        }
+        i = l - 1;
+    }
+
+    from_mont(out, acc);
+}
+
+template<size_t N>
+ZZ MontgomeryBackend<N>::multi_power(const vector<ZZ>& bases, const vector<ZZ>& exps) const {
+    ZZ result;
+    vector<mp_limb_t> scratch;
+    multi_power(result, bases, exps, scratch);
+    return result;
+}
+
+template<size_t N>
+void MontgomeryBackend<N>::multi_power(ZZ& out, const vector<ZZ>& bases, const vector<ZZ>& exps,
+                                       vector<mp_limb_t>& scratch) const {
+    if (bases.size() != exps.size())
+        throw runtime_error("multi_power: bases and exponents must have the same length!");
+
+    long k = (long)bases.size();
+    long maxbits = 0;
+    for (auto& e : exps) {
+        if (sign(e) < 0) throw runtime_error("multi_power: exponents must be non-negative!");
+        maxbits = max(maxbits, NumBits(e));
+    }
+    if (maxbits == 0) { conv(out, 1); return; }
+
+    // Straus: same window choice as multi_power_straus in multiexp.cpp
+    long w = 1;
+    double best = -1;
+    for (long c = 1; c <= 8; c++) {
+        double cost = (double)k * ((1L << c) - 2) + (double)k * ((maxbits + c - 1) / c);
+        if (best < 0 || cost < best) { best = cost; w = c; }
+    }
+    long digits = (1L << w) - 1;
+
+    // The table lives in scratch: allocated only when it has to grow, not per call or multiplication
+    size_t need = (size_t)(k * digits) * N;
+    if (scratch.size() < need) scratch.resize(need);
+    Limbs* table = reinterpret_cast<Limbs*>(scratch.data());
+    for (long i = 0; i < k; i++) {
+        Limbs* row = &table[i * digits];
+        to_mont(row[0], bases[i]);
+        for (long d = 1; d < digits; d++) mul(row[d], row[d - 1], row[0]);
+    }
+
+    Limbs acc = one_m;
+    long windows = (maxbits + w - 1) / w;
+    for (long j = windows - 1; j >= 0; j--) {
+        if (j != windows - 1) {
+            for (long s = 0; s < w; s++) sqr(acc, acc);
+        }
+
+        for (long i = 0; i < k; i++) {
+            long d = 0;
+            for (long b = w - 1; b >= 0; b--) d = (d << 1) | bit(exps[i], j * w + b);
+            if (d != 0) mul(acc, acc, table[i * digits + (d - 1)]);
+        }
+    }
+
+    from_mont(out, acc);
+}
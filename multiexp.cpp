@@ -0,0 +1,134 @@
+/*
+This file computes products of powers  ∏ base_i^(e_i) mod p.
+It is used to combine partial decryptions: S = ∏ D_i^(λ_i).
+Instead of running one full exponentiation per player (each with its own
+~|q| squarings), all players share ONE chain of squarings.
+*/
+
+#include "multiexp.h"
+#include <stdexcept>
+
+// Reads bits [pos, pos + w) of e as a number
+static long window_digit(const ZZ& e, long pos, long w) {
+    long d = 0;
+    for (long b = w - 1; b >= 0; b--)
+        d = (d << 1) | bit(e, pos + b);
+    return d;
+}
+
+// Checks the inputs and returns the bit length of the largest exponent
+static long check_inputs(const vector<ZZ>& bases, const vector<ZZ>& exps) {
+    if (bases.size() != exps.size())
+        throw runtime_error("multi_power: bases and exponents must have the same length!");
+
+    long maxbits = 0;
+    for (auto& e : exps) {
+        if (sign(e) < 0) throw runtime_error("multi_power: exponents must be non-negative!");
+        maxbits = max(maxbits, NumBits(e));
+    }
+    return maxbits;
+}
+
+ZZ multi_power(const vector<ZZ>& bases, const vector<ZZ>& exps, const ZZ& p) {
+    if (bases.size() >= PIPPENGER_THRESHOLD)
+        return multi_power_pippenger(bases, exps, p);
+    return multi_power_straus(bases, exps, p);
+}
+
+ZZ multi_power_straus(const vector<ZZ>& bases, const vector<ZZ>& exps, const ZZ& p) {
+    long maxbits = check_inputs(bases, exps);
+    long k = (long)bases.size();
+    if (maxbits == 0) return ZZ(1);
+
+    // Choosing the window w that minimizes (table cost) + (one multiplication per window per base)
+    long w = 1;
+    double best = -1;
+    for (long c = 1; c <= 8; c++) {
+        double cost = (double)k * ((1L << c) - 2) + (double)k * ((maxbits + c - 1) / c);
+        if (best < 0 || cost < best) { best = cost; w = c; }
+    }
+    long digits = (1L << w) - 1;
+
+    // table[i*digits + (d-1)] = bases[i]^d mod p
+    vector<ZZ> table(k * digits);
+    for (long i = 0; i < k; i++) {
+        ZZ* row = &table[i * digits];
+        row[0] = bases[i] % p;
+        for (long d = 1; d < digits; d++)
+            MulMod(row[d], row[d - 1], row[0], p);
+    }
+
+    ZZ result(1);
+    long windows = (maxbits + w - 1) / w;
+
+    // Going from the most significant window down to the least significant one
+    for (long j = windows - 1; j >= 0; j--) {
+        if (j != windows - 1) {
+            for (long s = 0; s < w; s++)
+                SqrMod(result, result, p); // shared squarings for all bases
+        }
+
+        for (long i = 0; i < k; i++) {
+            long d = window_digit(exps[i], j * w, w);
+            if (d != 0) MulMod(result, result, table[i * digits + (d - 1)], p);
+        }
+    }
+
+    return result;
+}
+
+ZZ multi_power_pippenger(const vector<ZZ>& bases, const vector<ZZ>& exps, const ZZ& p) {
+    long maxbits = check_inputs(bases, exps);
+    long k = (long)bases.size();
+    if (maxbits == 0) return ZZ(1);
+
+    // Choosing the window c that minimizes  windows * (k bucket insertions + 2 * 2^c bucket sums)
+    long c = 1;
+    double best = -1;
+    for (long w = 1; w <= 16; w++) {
+        double cost = (double)((maxbits + w - 1) / w) * ((double)k + 2.0 * (1L << w));
+        if (best < 0 || cost < best) { best = cost; c = w; }
+    }
+    long nbuckets = (1L << c) - 1;
+
+    vector<ZZ> reduced(k);
+    for (long i = 0; i < k; i++) reduced[i] = bases[i] % p;
+
+    vector<ZZ> buckets(nbuckets);
+    vector<char> used(nbuckets);
+
+    ZZ result(1);
+    ZZ running, window_sum;
+    long windows = (maxbits + c - 1) / c;
+
+    for (long j = windows - 1; j >= 0; j--) {
+        if (j != windows - 1) {
+            for (long s = 0; s < c; s++)
+                SqrMod(result, result, p);
+        }
+
+        // Putting every base into the bucket of its current digit
+        fill(used.begin(), used.end(), 0);
+        for (long i = 0; i < k; i++) {
+            long d = window_digit(exps[i], j * c, c);
+            if (d == 0) continue;
+            if (!used[d - 1]) { buckets[d - 1] = reduced[i]; used[d - 1] = 1; }
+            else MulMod(buckets[d - 1], buckets[d - 1], reduced[i], p);
+        }
+
+        // window_sum = ∏ bucket_d^d, computed with running products from the top bucket down
+        bool have_running = false;
+        window_sum = 1;
+        for (long d = nbuckets; d >= 1; d--) {
+            if (used[d - 1]) {
+                if (have_running) MulMod(running, running, buckets[d - 1], p);
+                else { running = buckets[d - 1]; have_running = true; }
+            }
+            if (have_running) MulMod(window_sum, window_sum, running, p);
+        }
+
+        MulMod(result, result, window_sum, p);
+    }
+
+    return result;
+}
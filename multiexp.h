@@ -0,0 +1,24 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <NTL/ZZ.h>
+#include <vector>
+
+using namespace NTL;
+using namespace std;
+
+// Multi-exponentiation: computes  bases[0]^exps[0] * bases[1]^exps[1] * ... mod p
+// All bases share the same squarings, so this is much cheaper than k separate PowerMod calls.
+// Exponents must be non-negative.
+
+// Number of bases from which Pippenger beats Straus (measured with bench.cpp)
+const size_t PIPPENGER_THRESHOLD = 128;
+
+// Chooses Straus or Pippenger depending on the number of bases
+ZZ multi_power(const vector<ZZ>& bases, const vector<ZZ>& exps, const ZZ& p);
+
+// Straus / Shamir's trick: a small table per base, then one pass over all exponents window by window
+// (best for a small number of bases)
+ZZ multi_power_straus(const vector<ZZ>& bases, const vector<ZZ>& exps, const ZZ& p);
+
+// Pippenger bucket method: no per-base tables, bases are sorted into buckets by their window digit
+// (best for a large number of bases)
+ZZ multi_power_pippenger(const vector<ZZ>& bases, const vector<ZZ>& exps, const ZZ& p);
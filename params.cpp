@@ -1,9 +1,6 @@
 #include "params.h"
 
-// define global parameters
-ZZ p, q, g;
-
-void load_parameters() {
+void builtin_modp_parameters(ZZ& p, ZZ& q, ZZ& g) {
     // **** REMEMBER! ****
     // Paste the numbers as plain digits only (no spaces, no commas).
     // If the number is too long for one line, split it into multiple strings and use "".
@@ -46,3 +43,15 @@ void load_parameters() {
     p = conv<ZZ>(p_long_str);
     g = conv<ZZ>(g_long_str);
 }
+
+Group load_parameters(long g_window) {
+    ZZ p, q, g;
+    builtin_modp_parameters(p, q, g);
+    return make_group(p, q, g, g_window);
+}
+
+Group load_group(const string& name, long g_window) {
+    if (name == "modp") return load_parameters(g_window);
+
+    return make_ec_group(name);
+}
@@ -1,12 +1,16 @@
 #pragma once // This is used to prevent the same file from being included more than once during compilation
 #include <NTL/ZZ.h>
+#include "group.h"
 
 using namespace NTL;
 
-// Global parameters for all functions
-extern ZZ p;
-extern ZZ q;
-extern ZZ g;
+// Loading the project's p, q and g (and the precomputed table of g) into a Group
+// g_window sets the size of the g table (bigger window = bigger table, faster g^e)
+Group load_parameters(long g_window = DEFAULT_G_WINDOW);
 
-// Loading p,q and g into the global parameters
-void load_parameters();
+// Only the numbers p, q, g of the group above (without building the Group)
+void builtin_modp_parameters(ZZ& p, ZZ& q, ZZ& g);
+
+// Choosing the group by name at runtime:
+// "modp" = the parameters above, "P-256" / "P-384" / "P-521" = an elliptic curve group
+Group load_group(const string& name, long g_window = DEFAULT_G_WINDOW);
@@ -0,0 +1,226 @@
+/*
+This file creates and checks Chaum-Pedersen proofs that a partial decryption
+D_i = B^(a_i) was computed with the same a_i as the published key V_i = g^(a_i).
+Checking many proofs is done with one random linear combination (see proofs.h).
+*/
+
+#include "proofs.h"
+#include "metrics.h"
+#include "subgroup.h"
+#include <openssl/sha.h>
+#include <stdexcept>
+
+// The checks below (range, Jacobi symbol, inverses mod p) are written for the numbers mod p
+static void require_prime_field(const Group& G) {
+    if (G.curve) throw runtime_error("Partial decryption proofs are only implemented for the prime-field group!");
+}
+
+// 0 < x < p
+static bool in_range(const ZZ& x, const Group& G) {
+    return sign(x) > 0 && x < G.p;
+}
+
+// Fiat-Shamir challenge c = SHA-256(label || i || B || V || D || t1 || t2) as a number mod q
+static ZZ challenge(long index, const ZZ& B, const ZZ& V, const ZZ& D, const ZZ& t1, const ZZ& t2, const Group& G) {
+    static const char label[] = "threshold-elgamal chaum-pedersen v1";
+    long width = NumBytes(G.p);
+
+    vector<unsigned char> data(label, label + sizeof(label));
+    for (int k = 0; k < 8; k++) data.push_back((unsigned char)((unsigned long)index >> (8 * k)));
+
+    // Every number with the same fixed width, so the encoding cannot be ambiguous
+    for (const ZZ* x : { &B, &V, &D, &t1, &t2 }) {
+        size_t at = data.size();
+        data.resize(at + width);
+        BytesFromZZ(data.data() + at, *x, width);
+    }
+
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    SHA256(data.data(), data.size(), digest);
+
+    return ZZFromBytes(digest, SHA256_DIGEST_LENGTH) % G.q;
+}
+
+VerifiablePartial partial_decrypt_with_proof(const ZZ& B, const Share& share, const ZZ& verification_key, const Group& G) {
+    require_prime_field(G);
+
+    VerifiablePartial d;
+    d.index = share.index;
+    d.D = group_power(G, B, share.value); // D_i = B^(a_i), same as partial_decrypt
+
+    ZZ r = RandomBnd(G.q);
+    d.proof.t1 = fixed_base_power(G.g_table, r);
+    d.proof.t2 = group_power(G, B, r);
+
+    ZZ c = challenge(share.index, B, verification_key, d.D, d.proof.t1, d.proof.t2, G);
+    d.proof.z = AddMod(r, MulMod(c, share.value, G.q), G.q); // z = r + c * a_i mod q
+
+    return d;
+}
+
+bool verify_partial(const ZZ& B, const VerifiablePartial& d, const ZZ& verification_key, const Group& G) {
+    require_prime_field(G);
+    const PartialProof& pr = d.proof;
+
+    if (!in_range(B, G) || !in_range(d.D, G) || !in_range(pr.t1, G) || !in_range(pr.t2, G)) return false;
+    if (sign(pr.z) < 0 || pr.z >= G.q) return false;
+
+    // D must be in the subgroup of order q, otherwise a small-order factor could slip past the check below
+    if (group_power(G, d.D, G.q) != 1) return false;
+
+    ZZ c = challenge(d.index, B, verification_key, d.D, pr.t1, pr.t2, G);
+
+    // g^z == t1 * V^c
+    if (fixed_base_power(G.g_table, pr.z) != MulMod(pr.t1, group_power(G, verification_key, c), G.p)) return false;
+
+    // B^z == t2 * D^c
+    return group_power(G, B, pr.z) == MulMod(pr.t2, group_power(G, d.D, c), G.p);
+}
+
+// Inverting all of xs mod p with a single InvMod (Montgomery's trick)
+static vector<ZZ> batch_invert(const vector<ZZ>& xs, const Group& G) {
+    size_t n = xs.size();
+    vector<ZZ> prefix(n + 1), inv(n);
+
+    prefix[0] = 1;
+    for (size_t i = 0; i < n; i++) prefix[i + 1] = MulMod(prefix[i], xs[i], G.p);
+
+    ZZ acc = InvMod(prefix[n], G.p); // 1 / (x_0 * x_1 * ... * x_{n-1})
+    TE_COUNT(M_INVERSIONS, 1);
+    for (size_t i = n; i-- > 0;) {
+        inv[i] = MulMod(acc, prefix[i], G.p);
+        acc = MulMod(acc, xs[i], G.p);
+    }
+
+    return inv;
+}
+
+bool verify_partials_batch(
+    const vector<ZZ>& Bs,
+    const vector<vector<VerifiablePartial>>& partials,
+    const vector<ZZ>& verification_keys,
+    const Group& G
+) {
+    TE_TIME(T_VERIFY_PROOFS);
+    require_prime_field(G);
+    if (Bs.size() != partials.size())
+        throw runtime_error("Number of ciphertexts and partial lists must match!");
+
+    /*
+	    First every B and D must be in the subgroup of order q (see subgroup.h: exact
+	    checks in SIMD lanes for the built-in group, whose (p-1)/(2q) is even).
+	    Without this, a D with a small-order part (for example p - D, because -1 is a
+	    square when p = 1 mod 4) would pass the combination below with probability 1/ℓ.
+
+	    t1 and t2 need no such check: Z_p^* is the subgroup times a group of order
+	    (p-1)/q, so the combination is 1 only if its part in the subgroup is 1, and that
+	    part is the check of the proof with t1, t2 replaced by their subgroup parts.
+	    With B and D in the subgroup it still proves log_g(V) == log_B(D) (c hashes the
+	    whole t1, t2, fixed before z). A small-order part in t1 or t2 can only make the
+	    batch fail, and find_bad_partials (exact checks) rejects such a proof anyway.
+
+	    Then, for every proof, with random 128-bit d1, d2:
+
+	        (g^z * t1^-1 * V^-c)^d1 * (B^z * t2^-1 * D^-c)^d2 == 1
+
+	    The product over all proofs is collected into one exponent per base:
+	    g and V_i (both in the subgroup, so their exponents can be reduced mod q),
+	    every B, and 1/D, 1/t1, 1/t2 of every proof.
+    */
+    vector<ZZ> elements;
+    for (size_t j = 0; j < Bs.size(); j++) {
+        if (!in_range(Bs[j], G)) return false;
+        elements.push_back(Bs[j]);
+
+        for (auto& d : partials[j]) {
+            const PartialProof& pr = d.proof;
+            if (d.index < 1 || d.index > (long)verification_keys.size()) return false;
+            if (!in_range(d.D, G) || !in_range(pr.t1, G) || !in_range(pr.t2, G)) return false;
+            if (sign(pr.z) < 0 || pr.z >= G.q) return false;
+
+            elements.push_back(d.D);
+        }
+    }
+    if (!subgroup_check_batch(elements, G)) return false;
+
+    ZZ g_exp(0);
+    vector<ZZ> v_exp(verification_keys.size());
+    vector<ZZ> bases, exps, to_invert, inv_exps;
+
+    for (size_t j = 0; j < Bs.size(); j++) {
+        const ZZ& B = Bs[j];
+
+        ZZ b_exp(0);
+        for (auto& d : partials[j]) {
+            const PartialProof& pr = d.proof;
+
+            ZZ c = challenge(d.index, B, verification_keys[d.index - 1], d.D, pr.t1, pr.t2, G);
+            ZZ d1 = RandomBits_ZZ(128);
+            ZZ d2 = RandomBits_ZZ(128);
+
+            g_exp += d1 * pr.z;
+            v_exp[d.index - 1] += d1 * c;
+            b_exp += d2 * pr.z;
+
+            to_invert.push_back(d.D);
+            inv_exps.push_back(d2 * c);
+            to_invert.push_back(pr.t1);
+            inv_exps.push_back(d1);
+            to_invert.push_back(pr.t2);
+            inv_exps.push_back(d2);
+        }
+
+        if (!IsZero(b_exp)) {
+            bases.push_back(B);
+            exps.push_back(b_exp);
+        }
+    }
+
+    // V_i^(-sum d1*c) = V_i^(q - (sum d1*c mod q))
+    for (size_t i = 0; i < verification_keys.size(); i++) {
+        ZZ e = v_exp[i] % G.q;
+        if (IsZero(e)) continue;
+        bases.push_back(verification_keys[i]);
+        exps.push_back(G.q - e);
+    }
+
+    vector<ZZ> inverses = batch_invert(to_invert, G);
+    bases.insert(bases.end(), inverses.begin(), inverses.end());
+    exps.insert(exps.end(), inv_exps.begin(), inv_exps.end());
+
+    // One multi-exponentiation for everything except g (which has its own table)
+    ZZ rest(1);
+    if (!bases.empty()) rest = group_multi_power(G, bases, exps);
+
+    return MulMod(fixed_base_power(G.g_table, g_exp % G.q), rest, G.p) == 1;
+}
+
+bool verify_partials_batch(
+    const ZZ& B,
+    const vector<VerifiablePartial>& partials,
+    const vector<ZZ>& verification_keys,
+    const Group& G
+) {
+    return verify_partials_batch(vector<ZZ>{ B }, vector<vector<VerifiablePartial>>{ partials }, verification_keys, G);
+}
+
+vector<PartialFault> find_bad_partials(
+    const vector<ZZ>& Bs,
+    const vector<vector<VerifiablePartial>>& partials,
+    const vector<ZZ>& verification_keys,
+    const Group& G
+) {
+    vector<PartialFault> faults;
+    if (verify_partials_batch(Bs, partials, verification_keys, G)) return faults;
+
+    // Something is wrong: checking every proof on its own to find out who
+    for (size_t j = 0; j < Bs.size(); j++) {
+        for (auto& d : partials[j]) {
+            bool ok = d.index >= 1 && d.index <= (long)verification_keys.size()
+                      && verify_partial(Bs[j], d, verification_keys[d.index - 1], G);
+            if (!ok) faults.push_back({ j, d.index });
+        }
+    }
+
+    return faults;
+}
@@ -0,0 +1,94 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <NTL/ZZ.h>
+#include <vector>
+#include "group.h"
+#include "shamir.h"
+
+using namespace NTL;
+using namespace std;
+
+/*
+Chaum-Pedersen proofs of correct partial decryption.
+
+Player i publishes V_i = g^(a_i) when the shares are made (shamir_split with verification keys).
+With a partial decryption D_i = B^(a_i) the player proves, without revealing a_i, that
+
+    log_g(V_i) == log_B(D_i)
+
+Proof (non-interactive, the challenge c is a SHA-256 hash of everything):
+    t1 = g^r,  t2 = B^r               (r random mod q)
+    c  = H(i, B, V_i, D_i, t1, t2)
+    z  = r + c * a_i mod q
+Check:
+    g^z == t1 * V_i^c   and   B^z == t2 * D_i^c   (and D_i is in the subgroup of order q)
+
+We keep t1, t2 in the proof (instead of only c) so that many proofs can be checked at once.
+Only the prime-field group is supported (the functions throw for an elliptic curve group).
+*/
+struct PartialProof {
+    ZZ t1;
+    ZZ t2;
+    ZZ z;
+};
+
+// A partial decryption D = B^(a_i) of player index, with its proof
+struct VerifiablePartial {
+    long index;
+    ZZ D;
+    PartialProof proof;
+};
+
+// Partial decryption + proof, computed by the player holding share
+VerifiablePartial partial_decrypt_with_proof(const ZZ& B, const Share& share, const ZZ& verification_key, const Group& G);
+
+// Checking one proof exactly (including D^q == 1). Costs about five exponentiations.
+bool verify_partial(const ZZ& B, const VerifiablePartial& d, const ZZ& verification_key, const Group& G);
+
+/*
+Checking the proofs of many partials for many ciphertexts at once:
+partials[j] are the partials for ciphertext Bs[j], verification_keys[i-1] belongs to player i.
+
+All the check equations are raised to random 128-bit powers and multiplied together,
+which leaves one fixed-base power of g and one multi-exponentiation for the whole batch.
+Before that, every B and D_i is checked to be in the subgroup of order q
+(subgroup_check_batch, see subgroup.h), because the combination only proves something about
+the part of D_i in that subgroup: for the built-in group (p-1)/(2q) is even and -1 has Jacobi
+symbol 1, so p - D_i would otherwise pass one combination with probability 1/2.
+(t1 and t2 need no check: a small-order part in them can only make the batch fail.)
+For the built-in group the D_i checks are exact (one exponentiation each, in SIMD lanes),
+so the batch costs about as much per proof as the partial decryption itself: less than
+half of verify_partial, but not the handful of multiplications it would be in a group
+with a safe prime.
+If every proof is valid this returns true. If one is not, it returns false except with
+probability about 2^-64 (subgroup checks) + 2^-128 (combination).
+Use find_bad_partials (exact checks) to find who cheated.
+*/
+bool verify_partials_batch(
+    const vector<ZZ>& Bs,
+    const vector<vector<VerifiablePartial>>& partials,
+    const vector<ZZ>& verification_keys,
+    const Group& G
+);
+
+// One ciphertext
+bool verify_partials_batch(
+    const ZZ& B,
+    const vector<VerifiablePartial>& partials,
+    const vector<ZZ>& verification_keys,
+    const Group& G
+);
+
+// A partial whose proof failed: which ciphertext, and which player
+struct PartialFault {
+    size_t ciphertext;
+    long index;
+};
+
+// Batch check first (the common case: nobody cheated); only if it fails,
+// every proof is checked on its own to name the cheaters
+vector<PartialFault> find_bad_partials(
+    const vector<ZZ>& Bs,
+    const vector<vector<VerifiablePartial>>& partials,
+    const vector<ZZ>& verification_keys,
+    const Group& G
+);
@@ -0,0 +1,236 @@
+/*
+This file implements the registry of named groups and their parameter files (see registry.h).
+*/
+
+#include "registry.h"
+#include "params.h"
+#include "serialize.h"
+#include <cctype>
+#include <fstream>
+#include <stdexcept>
+
+//-----------------------------------------------------
+//------------- Parameter files -----------------------
+//-----------------------------------------------------
+
+static string trim(const string& s) {
+    size_t b = s.find_first_not_of(" \t\r");
+    if (b == string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e - b + 1);
+}
+
+// Names end up in cache file names, so only letters, digits, '.', '_' and '-' are allowed
+static bool valid_name(const string& name) {
+    if (name.empty() || name[0] == '.') return false;
+    for (char c : name) {
+        if (!isalnum((unsigned char)c) && c != '.' && c != '_' && c != '-') return false;
+    }
+    return true;
+}
+
+// A number in decimal or 0x hex
+static bool parse_number(const string& s, ZZ& x) {
+    bool hex = s.size() > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X');
+    string digits = hex ? s.substr(2) : s;
+    if (digits.empty()) return false;
+
+    x = 0;
+    for (char c : digits) {
+        int d;
+        if (c >= '0' && c <= '9') d = c - '0';
+        else if (hex && c >= 'a' && c <= 'f') d = c - 'a' + 10;
+        else if (hex && c >= 'A' && c <= 'F') d = c - 'A' + 10;
+        else return false;
+
+        if (hex) x <<= 4;
+        else x *= 10;
+        x += d;
+    }
+    return true;
+}
+
+vector<ParameterSet> read_parameter_file(const string& path) {
+    ifstream f(path);
+    if (!f) throw runtime_error("Cannot open parameter file " + path);
+
+    vector<ParameterSet> sets;
+    string line;
+    long line_no = 0;
+    auto fail = [&](const string& why) {
+        throw runtime_error(path + ":" + to_string(line_no) + ": " + why);
+    };
+
+    while (getline(f, line)) {
+        line_no++;
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+
+        if (line[0] == '[') {
+            if (line.back() != ']') fail("missing ']'");
+            ParameterSet ps;
+            ps.name = trim(line.substr(1, line.size() - 2));
+            if (!valid_name(ps.name)) fail("invalid group name '" + ps.name + "'");
+            sets.push_back(ps);
+            continue;
+        }
+
+        size_t eq = line.find('=');
+        if (eq == string::npos) fail("expected 'key = value'");
+        if (sets.empty()) fail("value outside of a [group] section");
+
+        string key = trim(line.substr(0, eq));
+        string value = trim(line.substr(eq + 1));
+        ParameterSet& ps = sets.back();
+
+        if (key == "curve") ps.curve = value;
+        else if (key == "p" || key == "q" || key == "g") {
+            ZZ& x = key == "p" ? ps.p : key == "q" ? ps.q : ps.g;
+            if (!parse_number(value, x)) fail("'" + key + "' is not a number");
+        } else {
+            fail("unknown key '" + key + "'");
+        }
+    }
+
+    for (auto& ps : sets) {
+        bool has_numbers = !IsZero(ps.p) || !IsZero(ps.q) || !IsZero(ps.g);
+        if (ps.curve.empty() && (IsZero(ps.p) || IsZero(ps.q) || IsZero(ps.g)))
+            throw runtime_error(path + ": group '" + ps.name + "' needs p, q and g (or a curve)");
+        if (!ps.curve.empty() && has_numbers)
+            throw runtime_error(path + ": group '" + ps.name + "' has both a curve and p, q, g");
+    }
+
+    return sets;
+}
+
+void validate_parameter_set(const ParameterSet& ps) {
+    if (!ps.curve.empty()) {
+        make_ec_curve(ps.curve); // throws for an unknown curve or one with a cofactor
+        return;
+    }
+
+    const ZZ& p = ps.p;
+    const ZZ& q = ps.q;
+    const ZZ& g = ps.g;
+    string where = "Group '" + ps.name + "': ";
+
+    if (q <= 2 || p <= q) throw runtime_error(where + "need 2 < q < p!");
+    if (!ProbPrime(q)) throw runtime_error(where + "q is not prime!");
+    if (!IsZero((p - 1) % q)) throw runtime_error(where + "q does not divide p - 1!");
+    if (!ProbPrime(p)) throw runtime_error(where + "p is not prime!");
+
+    // g != 1 and g^q == 1 with q prime means the order of g is exactly q
+    if (g <= 1 || g >= p) throw runtime_error(where + "need 1 < g < p!");
+    if (PowerMod(g, q, p) != 1) throw runtime_error(where + "g does not have order q!");
+}
+
+//-----------------------------------------------------
+//------------- Registry ------------------------------
+//-----------------------------------------------------
+
+GroupRegistry::GroupRegistry(long g_window) : g_window(g_window) {
+    ParameterSet modp;
+    modp.name = "modp";
+    builtin_modp_parameters(modp.p, modp.q, modp.g);
+    entries["modp"] = Entry{ modp, true, nullptr };
+
+    for (const char* curve : { "P-256", "P-384", "P-521" }) {
+        ParameterSet ps;
+        ps.name = curve;
+        ps.curve = curve;
+        entries[curve] = Entry{ ps, true, nullptr };
+    }
+}
+
+void GroupRegistry::add(const ParameterSet& ps) {
+    if (!valid_name(ps.name)) throw runtime_error("Invalid group name '" + ps.name + "'!");
+
+    lock_guard<mutex> lock(m);
+    auto it = entries.find(ps.name);
+    if (it != entries.end() && it->second.group)
+        throw runtime_error("Group '" + ps.name + "' is already in use and cannot be replaced!");
+
+    entries[ps.name] = Entry{ ps, false, nullptr };
+}
+
+void GroupRegistry::load_file(const string& path) {
+    for (auto& ps : read_parameter_file(path)) add(ps);
+}
+
+vector<string> GroupRegistry::names() const {
+    lock_guard<mutex> lock(m);
+    vector<string> out;
+    for (auto& e : entries) out.push_back(e.first);
+    return out;
+}
+
+GroupRegistry::Entry& GroupRegistry::find(const string& name) {
+    auto it = entries.find(name);
+    if (it == entries.end()) throw runtime_error("Unknown group '" + name + "'!");
+    return it->second;
+}
+
+// Validating (unless built in) and building from scratch
+Group GroupRegistry::build(Entry& e) {
+    if (!e.trusted) {
+        validate_parameter_set(e.params);
+        validation_count++;
+    }
+
+    if (!e.params.curve.empty()) return make_ec_group(e.params.curve);
+    return make_group(e.params.p, e.params.q, e.params.g, g_window);
+}
+
+const Group& GroupRegistry::get(const string& name) {
+    lock_guard<mutex> lock(m);
+    Entry& e = find(name);
+    if (!e.group) e.group.reset(new Group(build(e)));
+    return *e.group;
+}
+
+const Group& GroupRegistry::get(const string& name, const string& cache_dir) {
+    lock_guard<mutex> lock(m);
+    Entry& e = find(name);
+    if (e.group) return *e.group;
+
+    // Curves have no tables to precompute, there is nothing to cache
+    if (!e.params.curve.empty()) {
+        e.group.reset(new Group(build(e)));
+        return *e.group;
+    }
+
+    string path = cache_dir + "/" + name + ".group";
+
+    // A cache is only used if it holds exactly these numbers and the same table size;
+    // a missing, damaged or outdated file is simply rebuilt
+    try {
+        Group cached = read_group_cache(path);
+        if (cached.p == e.params.p && cached.q == e.params.q && cached.g == e.params.g
+            && cached.g_table.window == g_window) {
+            cache_load_count++;
+            e.group.reset(new Group(move(cached)));
+            return *e.group;
+        }
+    } catch (const exception&) {
+    }
+
+    e.group.reset(new Group(build(e)));
+
+    // The cache only saves time next time: if it cannot be written (missing directory,
+    // full disk, read-only mount), the group that was just built is still returned
+    try {
+        write_group_cache(path, *e.group);
+    } catch (const exception&) {
+    }
+    return *e.group;
+}
+
+size_t GroupRegistry::cache_loads() const {
+    lock_guard<mutex> lock(m);
+    return cache_load_count;
+}
+
+size_t GroupRegistry::validations() const {
+    lock_guard<mutex> lock(m);
+    return validation_count;
+}
@@ -0,0 +1,91 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <NTL/ZZ.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "group.h"
+
+using namespace NTL;
+using namespace std;
+
+/*
+A registry of named parameter sets ("groups").
+
+Built in: "modp" (the project's p, q, g) and the curves "P-256", "P-384", "P-521".
+More prime-field groups can be read from a text file:
+
+    # comment
+    [my-group]
+    p = 0xFFFF...       (decimal or 0x hex)
+    q = ...
+    g = ...
+
+    [small-curve]
+    curve = P-256
+
+A group from a file is validated before it is first used (p and q prime, q divides p-1,
+g of order q), which costs seconds for big p. With a cache directory, the built Group
+(the table of g included) is saved as a binary group cache after validation, and later
+processes load that file with mmap instead of validating and precomputing again.
+*/
+
+// One parameter set as written in a file
+struct ParameterSet {
+    string name;
+    string curve;   // "P-256", "P-384" or "P-521" for a curve group, empty for numbers mod p
+    ZZ p;
+    ZZ q;
+    ZZ g;
+};
+
+// Reading every parameter set of a file (throws with the line number on a syntax error)
+vector<ParameterSet> read_parameter_file(const string& path);
+
+// Checking that the numbers really make a group of prime order q. Throws with the reason.
+void validate_parameter_set(const ParameterSet& ps);
+
+// Thread-safe. Groups are built on first use and stay in the registry (references stay valid).
+class GroupRegistry {
+public:
+    // g_window sets the size of the table of g for every prime-field group
+    explicit GroupRegistry(long g_window = DEFAULT_G_WINDOW);
+
+    // Adding (or replacing, before its first use) a parameter set; the numbers are checked on first use
+    void add(const ParameterSet& ps);
+
+    // Adding every parameter set of a file
+    void load_file(const string& path);
+
+    vector<string> names() const;
+
+    // The group called name: validated and built the first time, then the same object every time
+    const Group& get(const string& name);
+
+    // Same, but through a group cache file <cache_dir>/<name>.group:
+    // loaded if it is intact and holds exactly this parameter set, otherwise
+    // the group is validated and built as usual and the cache is (re)written
+    // (if the cache cannot be written, the group is still returned)
+    const Group& get(const string& name, const string& cache_dir);
+
+    // How the groups were obtained so far (for tests and benchmarks)
+    size_t cache_loads() const;
+    size_t validations() const;
+
+private:
+    struct Entry {
+        ParameterSet params;
+        bool trusted;             // built-in sets are not validated again
+        unique_ptr<Group> group;  // nullptr until first use
+    };
+
+    long g_window;
+    mutable mutex m;
+    map<string, Entry> entries;
+    size_t cache_load_count = 0;
+    size_t validation_count = 0;
+
+    Entry& find(const string& name);
+    Group build(Entry& e);
+};
@@ -0,0 +1,498 @@
+/*
+This file reads and writes the binary store format described in serialize.h.
+Writers produce the fixed-width little-endian layout, and the views read it
+in place from a memory buffer (normally an mmap'd file) without copying.
+*/
+
+#include "serialize.h"
+#include <openssl/crypto.h> // CRYPTO_memcmp
+#include <openssl/evp.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib> // mkstemp
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+
+static const unsigned char STORE_MAGIC[4] = { 'T', 'E', 'G', 'B' };
+
+//-----------------------------------------------------
+//------------- Little-endian helpers -----------------
+//-----------------------------------------------------
+
+static void put_le(unsigned char* out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) out[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint64_t get_le(const unsigned char* in, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= (uint64_t)in[i] << (8 * i);
+    return v;
+}
+
+// Writing x as exactly width little-endian bytes (x must be non-negative and fit)
+static void put_zz(unsigned char* out, const ZZ& x, size_t width) {
+    if (sign(x) < 0 || (size_t)NumBytes(x) > width)
+        throw runtime_error("Value does not fit the store's fixed width!");
+    BytesFromZZ(out, x, (long)width);
+}
+
+static void make_header(unsigned char* h, StoreKind kind, size_t width, size_t count) {
+    memset(h, 0, STORE_HEADER_LEN);
+    memcpy(h, STORE_MAGIC, 4);
+    put_le(h + 4, STORE_VERSION, 2);
+    put_le(h + 6, kind, 2);
+    put_le(h + 8, width, 4);
+    put_le(h + 16, count, 8);
+}
+
+// Checking the header and returning the width and count stored in it
+static void parse_header(const unsigned char* data, size_t len, StoreKind kind, size_t& width, size_t& count) {
+    if (len < STORE_HEADER_LEN || memcmp(data, STORE_MAGIC, 4) != 0)
+        throw runtime_error("Not a threshold-elgamal store (bad header)!");
+    if (get_le(data + 4, 2) != STORE_VERSION)
+        throw runtime_error("Unsupported store version!");
+    if (get_le(data + 6, 2) != kind)
+        throw runtime_error("Store holds a different kind of record!");
+
+    width = (size_t)get_le(data + 8, 4);
+    count = (size_t)get_le(data + 16, 8);
+    if (width == 0) throw runtime_error("Store has a zero field width!");
+}
+
+// Checking that count records of rec_len bytes fit in avail bytes (without overflowing)
+static void check_fits(size_t count, size_t rec_len, size_t avail) {
+    if (rec_len != 0 && count > avail / rec_len)
+        throw runtime_error("Store is truncated!");
+}
+
+//-----------------------------------------------------
+//------------- Writing --------------------------------
+//-----------------------------------------------------
+
+static void write_all_fd(int fd, const unsigned char* buf, size_t n, off_t offset) {
+    while (n > 0) {
+        ssize_t w = pwrite(fd, buf, n, offset);
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0) throw runtime_error("Store write failed: " + string(strerror(errno)));
+        buf += w;
+        n -= (size_t)w;
+        offset += w;
+    }
+}
+
+ShareStoreWriter::ShareStoreWriter(const string& path, size_t count, const Group& G)
+    : fd(-1), count(count), width((size_t)NumBytes(G.q)) {
+    // Shares are secret: only the owner may read the file
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) throw runtime_error("Cannot create " + path + ": " + strerror(errno));
+
+    unsigned char header[STORE_HEADER_LEN];
+    make_header(header, STORE_SHARES, width, count);
+    try {
+        write_all_fd(fd, header, STORE_HEADER_LEN, 0);
+        if (ftruncate(fd, (off_t)(STORE_HEADER_LEN + count * (8 + width))) != 0)
+            throw runtime_error("Cannot size " + path + ": " + strerror(errno));
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+}
+
+ShareStoreWriter::~ShareStoreWriter() {
+    if (fd >= 0) ::close(fd);
+}
+
+void ShareStoreWriter::put(size_t slot, long index, const ZZ& value) {
+    if (fd < 0) throw runtime_error("Share store is already closed!");
+    if (slot >= count) throw runtime_error("Share slot is outside the store!");
+    if (index < 0) throw runtime_error("Share index must not be negative!");
+
+    unsigned char rec[8 + 1024];
+    if (width > 1024) throw runtime_error("Share width is too large!");
+    put_le(rec, (uint64_t)index, 8);
+    put_zz(rec + 8, value, width);
+
+    // pwrite to the record's own position, so several threads can write at once
+    write_all_fd(fd, rec, 8 + width, (off_t)(STORE_HEADER_LEN + slot * (8 + width)));
+}
+
+void ShareStoreWriter::close() {
+    if (fd < 0) return;
+    int f = fd;
+    fd = -1;
+
+    // The descriptor is closed even when fsync fails; the first error is reported
+    int err = 0;
+    if (fsync(f) != 0) err = errno;
+    if (::close(f) != 0 && err == 0) err = errno;
+    if (err != 0) throw runtime_error("Closing share store failed: " + string(strerror(err)));
+}
+
+void write_share_store(const string& path, const vector<Share>& shares, const Group& G) {
+    ShareStoreWriter w(path, shares.size(), G);
+    for (size_t i = 0; i < shares.size(); i++)
+        w.put(i, shares[i].index, shares[i].value);
+    w.close();
+}
+
+static void write_to_file(const string& path, const function<void(const ByteOut&)>& produce) {
+    ofstream f(path, ios::binary | ios::trunc);
+    if (!f) throw runtime_error("Cannot create " + path);
+
+    produce([&](const unsigned char* b, size_t n) { f.write((const char*)b, (streamsize)n); });
+
+    f.flush();
+    if (!f) throw runtime_error("Writing " + path + " failed!");
+}
+
+void replace_file(const string& path, const function<void(const ByteOut&)>& produce) {
+    vector<char> name(path.begin(), path.end());
+    const char suffix[] = ".tmp.XXXXXX";
+    name.insert(name.end(), suffix, suffix + sizeof(suffix)); // with the terminating 0
+
+    int fd = mkstemp(name.data());
+    if (fd < 0) throw runtime_error("Cannot create a temporary file for " + path + ": " + strerror(errno));
+    string tmp = name.data();
+
+    // mkstemp creates the file for the owner only; everyone may read a cache or a metrics file
+    FILE* f = (fchmod(fd, 0644) == 0) ? fdopen(fd, "wb") : nullptr;
+    if (!f) {
+        int err = errno;
+        ::close(fd);
+        unlink(tmp.c_str());
+        throw runtime_error("Cannot open " + tmp + ": " + strerror(err));
+    }
+
+    try {
+        produce([&](const unsigned char* b, size_t n) {
+            if (fwrite(b, 1, n, f) != n) throw runtime_error("Writing " + tmp + " failed: " + strerror(errno));
+        });
+        if (fflush(f) != 0) throw runtime_error("Writing " + tmp + " failed: " + strerror(errno));
+    } catch (...) {
+        fclose(f);
+        unlink(tmp.c_str());
+        throw;
+    }
+
+    if (fclose(f) != 0) {
+        int err = errno;
+        unlink(tmp.c_str());
+        throw runtime_error("Writing " + tmp + " failed: " + strerror(err));
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        int err = errno;
+        unlink(tmp.c_str());
+        throw runtime_error("Cannot move " + tmp + " into place: " + strerror(err));
+    }
+}
+
+static void emit_public_keys(const vector<ZZ>& keys, const Group& G, const ByteOut& out) {
+    size_t width = (size_t)group_element_bytes(G);
+    unsigned char header[STORE_HEADER_LEN];
+    make_header(header, STORE_PUBLIC_KEYS, width, keys.size());
+    out(header, STORE_HEADER_LEN);
+
+    vector<unsigned char> rec(width);
+    for (auto& A : keys) {
+        put_zz(rec.data(), A, width);
+        out(rec.data(), width);
+    }
+}
+
+static void emit_ciphertexts(const vector<Ciphertext>& cts, const Group& G, const ByteOut& out) {
+    size_t width = (size_t)group_element_bytes(G);
+    unsigned char header[STORE_HEADER_LEN];
+    make_header(header, STORE_CIPHERTEXTS, width, cts.size());
+    out(header, STORE_HEADER_LEN);
+
+    // Offsets of every record (and of the end), relative to the first record
+    unsigned char le[8];
+    uint64_t offset = 0;
+    for (size_t i = 0; i <= cts.size(); i++) {
+        put_le(le, offset, 8);
+        out(le, 8);
+        if (i < cts.size()) offset += width + cts[i].aead.size();
+    }
+
+    vector<unsigned char> B(width);
+    for (auto& ct : cts) {
+        put_zz(B.data(), ct.B, width);
+        out(B.data(), width);
+        out(ct.aead.data(), ct.aead.size());
+    }
+}
+
+void write_public_key_store(const string& path, const vector<ZZ>& keys, const Group& G) {
+    write_to_file(path, [&](const ByteOut& out) { emit_public_keys(keys, G, out); });
+}
+
+void write_ciphertext_store(const string& path, const vector<Ciphertext>& cts, const Group& G) {
+    write_to_file(path, [&](const ByteOut& out) { emit_ciphertexts(cts, G, out); });
+}
+
+vector<unsigned char> ciphertexts_to_bytes(const vector<Ciphertext>& cts, const Group& G) {
+    vector<unsigned char> bytes;
+    emit_ciphertexts(cts, G, [&](const unsigned char* b, size_t n) { bytes.insert(bytes.end(), b, b + n); });
+    return bytes;
+}
+
+//-----------------------------------------------------
+//------------- Group cache ---------------------------
+//-----------------------------------------------------
+
+static const size_t CACHE_DIGEST_LEN = 32;
+
+static void emit_fixed_base(const FixedBase& fb, size_t width, const ByteOut& out) {
+    unsigned char le[16];
+    put_le(le, (uint64_t)fb.window, 4);
+    put_le(le + 4, (uint64_t)fb.max_bits, 4);
+    put_le(le + 8, fb.table.size(), 8);
+    out(le, 16);
+
+    vector<unsigned char> rec(width);
+    put_zz(rec.data(), fb.base, width);
+    out(rec.data(), width);
+    for (auto& x : fb.table) {
+        put_zz(rec.data(), x, width);
+        out(rec.data(), width);
+    }
+}
+
+void write_group_cache(const string& path, const Group& G, const vector<const FixedBase*>& extra_tables) {
+    if (G.curve) throw runtime_error("Group cache: only prime-field groups have tables to cache!");
+
+    size_t width = (size_t)NumBytes(G.p);
+    for (const FixedBase* fb : extra_tables) {
+        if (!fb || fb->p != G.p) throw runtime_error("Group cache: extra table is not mod this group's p!");
+    }
+
+    EVP_MD_CTX* md = EVP_MD_CTX_new();
+    if (!md || EVP_DigestInit_ex(md, EVP_sha256(), nullptr) != 1) {
+        EVP_MD_CTX_free(md);
+        throw runtime_error("Group cache: SHA-256 setup failed!!");
+    }
+
+    try {
+        replace_file(path, [&](const ByteOut& file) {
+            // Everything written is also hashed, and the digest goes at the end
+            ByteOut out = [&](const unsigned char* b, size_t n) {
+                EVP_DigestUpdate(md, b, n);
+                file(b, n);
+            };
+
+            unsigned char header[STORE_HEADER_LEN];
+            make_header(header, STORE_GROUP_CACHE, width, 1 + extra_tables.size());
+            out(header, STORE_HEADER_LEN);
+
+            vector<unsigned char> rec(width);
+            for (const ZZ* x : { &G.p, &G.q, &G.g }) {
+                put_zz(rec.data(), *x, width);
+                out(rec.data(), width);
+            }
+
+            emit_fixed_base(G.g_table, width, out);
+            for (const FixedBase* fb : extra_tables) emit_fixed_base(*fb, width, out);
+
+            unsigned char digest[CACHE_DIGEST_LEN];
+            if (EVP_DigestFinal_ex(md, digest, nullptr) != 1) throw runtime_error("Group cache: SHA-256 failed!!");
+            file(digest, CACHE_DIGEST_LEN);
+        });
+    } catch (...) {
+        EVP_MD_CTX_free(md);
+        throw;
+    }
+    EVP_MD_CTX_free(md);
+}
+
+// Reading one table written by emit_fixed_base, starting at pos (which is moved past it)
+static FixedBase read_fixed_base(const unsigned char* data, size_t end, size_t& pos, size_t width, const ZZ& p) {
+    if (end - pos < 16) throw runtime_error("Group cache is truncated!");
+    FixedBase fb;
+    fb.window = (long)get_le(data + pos, 4);
+    fb.max_bits = (long)get_le(data + pos + 4, 4);
+    size_t entries = (size_t)get_le(data + pos + 8, 8);
+    pos += 16;
+
+    // The lookup in fixed_base_power assumes exactly this many entries
+    if (fb.window < 1 || fb.window > 16 || fb.max_bits < 1)
+        throw runtime_error("Group cache has an invalid fixed-base table!");
+    size_t windows = (size_t)((fb.max_bits + fb.window - 1) / fb.window);
+    if (entries != windows * ((1UL << fb.window) - 1))
+        throw runtime_error("Group cache has a fixed-base table of the wrong size!");
+
+    check_fits(entries + 1, width, end - pos);
+    fb.base = ZZFromBytes(data + pos, (long)width);
+    fb.p = p;
+    pos += width;
+
+    fb.table.resize(entries);
+    for (size_t i = 0; i < entries; i++, pos += width)
+        fb.table[i] = ZZFromBytes(data + pos, (long)width);
+
+    return fb;
+}
+
+Group read_group_cache(const string& path, vector<FixedBase>* extra_tables) {
+    MappedFile file(path);
+    const unsigned char* data = file.data();
+    size_t len = file.size();
+
+    // Integrity first: nothing in the file is trusted before its digest matches
+    if (len < STORE_HEADER_LEN + CACHE_DIGEST_LEN) throw runtime_error("Group cache is truncated!");
+    size_t end = len - CACHE_DIGEST_LEN;
+
+    unsigned char digest[CACHE_DIGEST_LEN];
+    unsigned int digest_len = 0;
+    if (EVP_Digest(data, end, digest, &digest_len, EVP_sha256(), nullptr) != 1)
+        throw runtime_error("Group cache: SHA-256 failed!!");
+    if (CRYPTO_memcmp(digest, data + end, CACHE_DIGEST_LEN) != 0)
+        throw runtime_error("Group cache " + path + " failed its integrity check!");
+
+    size_t width, count;
+    parse_header(data, end, STORE_GROUP_CACHE, width, count);
+    if (count == 0) throw runtime_error("Group cache has no table of g!");
+
+    size_t pos = STORE_HEADER_LEN;
+    check_fits(3, width, end - pos);
+    ZZ p = ZZFromBytes(data + pos, (long)width);
+    ZZ q = ZZFromBytes(data + pos + width, (long)width);
+    ZZ g = ZZFromBytes(data + pos + 2 * width, (long)width);
+    pos += 3 * width;
+
+    FixedBase g_table = read_fixed_base(data, end, pos, width, p);
+
+    if (extra_tables) extra_tables->clear();
+    for (size_t i = 1; i < count; i++) {
+        FixedBase fb = read_fixed_base(data, end, pos, width, p);
+        if (extra_tables) extra_tables->push_back(move(fb));
+    }
+    if (pos != end) throw runtime_error("Group cache has trailing bytes!");
+
+    return make_group(p, q, g, move(g_table));
+}
+
+//-----------------------------------------------------
+//------------- Reading in place ----------------------
+//-----------------------------------------------------
+
+MappedFile::MappedFile(const string& path) : ptr(nullptr), len(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw runtime_error("Cannot open " + path + ": " + strerror(errno));
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        throw runtime_error("Cannot map empty or unreadable file " + path);
+    }
+
+    void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping stays valid after closing the descriptor
+    if (p == MAP_FAILED) throw runtime_error("mmap of " + path + " failed: " + strerror(errno));
+
+    ptr = (const unsigned char*)p;
+    len = (size_t)st.st_size;
+}
+
+MappedFile::~MappedFile() {
+    if (ptr) munmap((void*)ptr, len);
+}
+
+// ---- shares ----
+
+ShareStoreView::ShareStoreView(const unsigned char* data, size_t len) {
+    parse_header(data, len, STORE_SHARES, width, count);
+    check_fits(count, 8 + width, len - STORE_HEADER_LEN);
+    records = data + STORE_HEADER_LEN;
+}
+
+long ShareStoreView::index(size_t i) const {
+    if (i >= count) throw runtime_error("Share store index out of range!");
+    return (long)get_le(records + i * (8 + width), 8);
+}
+
+const unsigned char* ShareStoreView::value_bytes(size_t i) const {
+    if (i >= count) throw runtime_error("Share store index out of range!");
+    return records + i * (8 + width) + 8;
+}
+
+Share ShareStoreView::share(size_t i) const {
+    Share s;
+    s.index = index(i);
+    ZZFromBytes(s.value, value_bytes(i), (long)width);
+    return s;
+}
+
+// ---- public keys ----
+
+PublicKeyStoreView::PublicKeyStoreView(const unsigned char* data, size_t len) {
+    parse_header(data, len, STORE_PUBLIC_KEYS, width, count);
+    check_fits(count, width, len - STORE_HEADER_LEN);
+    records = data + STORE_HEADER_LEN;
+}
+
+const unsigned char* PublicKeyStoreView::key_bytes(size_t i) const {
+    if (i >= count) throw runtime_error("Public key store index out of range!");
+    return records + i * width;
+}
+
+ZZ PublicKeyStoreView::key(size_t i) const {
+    return ZZFromBytes(key_bytes(i), (long)width);
+}
+
+// ---- ciphertexts ----
+
+CiphertextStoreView::CiphertextStoreView(const unsigned char* data, size_t len) {
+    parse_header(data, len, STORE_CIPHERTEXTS, width, count);
+    if (count == SIZE_MAX) throw runtime_error("Store is truncated!");
+    check_fits(count + 1, 8, len - STORE_HEADER_LEN);
+
+    offsets = data + STORE_HEADER_LEN;
+    records = offsets + (count + 1) * 8;
+    records_len = len - STORE_HEADER_LEN - (count + 1) * 8;
+}
+
+void CiphertextStoreView::record(size_t i, size_t& begin, size_t& end) const {
+    if (i >= count) throw runtime_error("Ciphertext store index out of range!");
+
+    uint64_t b = get_le(offsets + i * 8, 8);
+    uint64_t e = get_le(offsets + (i + 1) * 8, 8);
+    if (b > e || e > records_len || e - b < width)
+        throw runtime_error("Ciphertext store has a corrupt offset table!");
+
+    begin = (size_t)b;
+    end = (size_t)e;
+}
+
+const unsigned char* CiphertextStoreView::B_bytes(size_t i) const {
+    size_t b, e;
+    record(i, b, e);
+    return records + b;
+}
+
+const unsigned char* CiphertextStoreView::aead_bytes(size_t i) const {
+    size_t b, e;
+    record(i, b, e);
+    return records + b + width;
+}
+
+size_t CiphertextStoreView::aead_size(size_t i) const {
+    size_t b, e;
+    record(i, b, e);
+    return e - b - width;
+}
+
+Ciphertext CiphertextStoreView::ciphertext(size_t i) const {
+    size_t b, e;
+    record(i, b, e);
+
+    Ciphertext ct;
+    ZZFromBytes(ct.B, records + b, (long)width);
+    ct.aead.assign(records + b + width, records + e);
+    return ct;
+}
@@ -0,0 +1,176 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <NTL/ZZ.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "group.h"
+#include "shamir.h"
+#include "threshold.h"
+
+using namespace NTL;
+using namespace std;
+
+/*
+Compact binary format for shares, public keys and hybrid ciphertexts.
+All integers are little-endian, all big numbers have a fixed width (in bytes).
+
+    header (32 bytes) = "TEGB" || version (u16) || kind (u16) || width (u32) || reserved (u32)
+                        || count (u64) || reserved (u64)
+
+    kind 1, shares:       count records of  index (u64) || a_i (width bytes),      width = bytes of q
+    kind 2, public keys:  count records of  A (width bytes),                       width = bytes of a group element
+    kind 3, ciphertexts:  offsets (count+1 u64, from the start of the records)
+                          then count records of  B (width bytes) || AEAD data (nonce || ciphertext || tag)
+    kind 4, group cache:  p || q || g (width bytes each),                          width = bytes of p
+                          then count fixed-base tables (the first one is the table of g), each
+                          window (u32) || max_bits (u32) || entries (u64) || base || entries * width bytes
+                          then SHA-256 of everything before it (32 bytes)
+
+Fixed-width records mean record i is found by arithmetic, so a store with millions of entries
+can be mmap'd and read in place; nothing is converted to ZZ until it is asked for.
+*/
+
+const uint16_t STORE_VERSION = 1;
+const size_t STORE_HEADER_LEN = 32;
+
+enum StoreKind : uint16_t {
+    STORE_SHARES = 1,
+    STORE_PUBLIC_KEYS = 2,
+    STORE_CIPHERTEXTS = 3,
+    STORE_GROUP_CACHE = 4
+};
+
+// ------------------------------
+// Writing
+// ------------------------------
+
+void write_share_store(const string& path, const vector<Share>& shares, const Group& G);
+void write_public_key_store(const string& path, const vector<ZZ>& keys, const Group& G);
+void write_ciphertext_store(const string& path, const vector<Ciphertext>& cts, const Group& G);
+
+// The same ciphertext format, in memory (for sending one or a few ciphertexts over the network)
+vector<unsigned char> ciphertexts_to_bytes(const vector<Ciphertext>& cts, const Group& G);
+
+// Writing a share store of known size, one share at a time, straight into its slot.
+// put() may be called from several threads at once (for example as the sink of shamir_split_stream).
+class ShareStoreWriter {
+public:
+    ShareStoreWriter(const string& path, size_t count, const Group& G);
+    ~ShareStoreWriter();
+
+    ShareStoreWriter(const ShareStoreWriter&) = delete;
+    ShareStoreWriter& operator=(const ShareStoreWriter&) = delete;
+
+    void put(size_t slot, long index, const ZZ& value);
+
+    // Flushing and closing the file (also done by the destructor, which cannot report errors)
+    void close();
+
+private:
+    int fd;
+    size_t count;
+    size_t width;
+};
+
+// ------------------------------
+// Group cache (precomputation that a new process can load instead of rebuilding)
+// ------------------------------
+
+// Output of the file writers: a function receiving consecutive bytes
+typedef function<void(const unsigned char*, size_t)> ByteOut;
+
+// Replacing the file at path as a whole: produce writes into a uniquely named temporary file
+// next to path (mkstemp, mode 0644), which is then renamed over path. Readers never see half
+// a file, and several processes or threads replacing the same path at once never write into
+// the same temporary file (the last rename wins). Throws if anything fails (path is unchanged).
+void replace_file(const string& path, const function<void(const ByteOut&)>& produce);
+
+// Saving p, q, g, the table of g and optionally tables of other fixed bases (for example public keys).
+// Prime-field groups only. Written with replace_file, so a process reading the cache
+// never sees a half-written file.
+void write_group_cache(const string& path, const Group& G, const vector<const FixedBase*>& extra_tables = {});
+
+// Loading a group cache with mmap: the SHA-256 of the whole file is checked first
+// (against corruption, not against someone who can rewrite the file), then the Group is
+// built around the stored table of g. The other tables go to extra_tables if given.
+Group read_group_cache(const string& path, vector<FixedBase>* extra_tables = nullptr);
+
+// ------------------------------
+// Reading in place
+// ------------------------------
+
+// A whole file mapped read-only into memory
+class MappedFile {
+public:
+    explicit MappedFile(const string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return ptr; }
+    size_t size() const { return len; }
+
+private:
+    const unsigned char* ptr;
+    size_t len;
+};
+
+// Views over store bytes (a MappedFile or any buffer, which must outlive the view).
+// Constructing a view only checks the header and the total size.
+class ShareStoreView {
+public:
+    ShareStoreView(const unsigned char* data, size_t len);
+
+    size_t size() const { return count; }
+    size_t value_width() const { return width; }
+
+    long index(size_t i) const;
+    const unsigned char* value_bytes(size_t i) const; // little-endian, value_width() bytes
+    Share share(size_t i) const;                      // converting to ZZ only here
+
+private:
+    const unsigned char* records;
+    size_t count;
+    size_t width;
+};
+
+class PublicKeyStoreView {
+public:
+    PublicKeyStoreView(const unsigned char* data, size_t len);
+
+    size_t size() const { return count; }
+    size_t key_width() const { return width; }
+
+    const unsigned char* key_bytes(size_t i) const;
+    ZZ key(size_t i) const;
+
+private:
+    const unsigned char* records;
+    size_t count;
+    size_t width;
+};
+
+class CiphertextStoreView {
+public:
+    CiphertextStoreView(const unsigned char* data, size_t len);
+
+    size_t size() const { return count; }
+    size_t B_width() const { return width; }
+
+    const unsigned char* B_bytes(size_t i) const;
+    const unsigned char* aead_bytes(size_t i) const;
+    size_t aead_size(size_t i) const;
+    Ciphertext ciphertext(size_t i) const;
+
+private:
+    const unsigned char* offsets;  // count + 1 little-endian u64
+    const unsigned char* records;
+    size_t records_len;
+    size_t count;
+    size_t width;
+
+    void record(size_t i, size_t& begin, size_t& end) const; // checked bounds of record i
+};
@@ -1,8 +1,10 @@
 #include "shamir.h"
 #include <NTL/ZZ_pX.h>
+#include <algorithm>
+#include <stdexcept>
 
-vector<Share> shamir_split(const ZZ& secret, long t, long n, const ZZ& q) {
-    ZZ_p::init(q); // Setting modulo q
+vector<Share> shamir_split(const ZZ& secret, long t, long n, const Group& G) {
+    ModQScope mod_q(G); // Setting modulo q (only on this thread, restored when we return)
 
     // f(x) = a + r1*x + r2*x^2   (for t = 2)
     ZZ_pX f;
@@ -12,7 +14,7 @@ vector<Share> shamir_split(const ZZ& secret, long t, long n, const ZZ& q) {
 
     // Random coefficients
     for (long i = 1; i <= t; i++) {
-        ZZ r = RandomBnd(q);
+        ZZ r = RandomBnd(G.q);
         SetCoeff(f, i, conv<ZZ_p>(r)); // converts integer r into mod-q type
     }
 
@@ -32,9 +34,20 @@ vector<Share> shamir_split(const ZZ& secret, long t, long n, const ZZ& q) {
     return shares;
 }
 
-ZZ shamir_reconstruct(const vector<Share>& shares, const ZZ& q) {
-    ZZ_p::init(q); // It sets the global modulus q for the type ZZ_p
-                   // ZZ_p is a modular integer type in NTL library
+vector<Share> shamir_split(const ZZ& secret, long t, long n, const Group& G, vector<ZZ>& verification_keys) {
+    vector<Share> shares = shamir_split(secret, t, n, G);
+
+    // V_i = g^(a_i) (mod p, with the precomputed table of g)
+    verification_keys.clear();
+    for (auto& s : shares)
+        verification_keys.push_back(group_power_g(G, s.value));
+
+    return shares;
+}
+
+ZZ shamir_reconstruct(const vector<Share>& shares, const Group& G) {
+    ModQScope mod_q(G); // It sets the modulus q for the type ZZ_p on this thread
+                        // ZZ_p is a modular integer type in NTL library
 
     long k = shares.size(); // k = number of shares used
 
@@ -53,3 +66,70 @@ ZZ shamir_reconstruct(const vector<Share>& shares, const ZZ& q) {
     // secret = f(0)
     return rep(eval(f, ZZ_p(0)));
 }
+
+vector<ZZ> shamir_random_polynomial(const ZZ& secret, long t, const Group& G) {
+    if (t < 0) throw runtime_error("Threshold t must not be negative!");
+
+    vector<ZZ> coeffs(t + 1);
+    coeffs[0] = secret % G.q; // constant term = secret
+    for (long i = 1; i <= t; i++)
+        coeffs[i] = RandomBnd(G.q); // random coefficients
+
+    return coeffs;
+}
+
+/*
+Forward differences: for a polynomial f of degree t, the t-th difference is constant.
+If we know   d_0 = f(x), d_1 = Δf(x), ..., d_t = Δ^t f(x)   (where Δf(x) = f(x+1) - f(x)),
+then moving from x to x+1 is just   d_j = d_j + d_(j+1)   for j = 0 .. t-1.
+So after seeding, every new share costs t additions mod q and no multiplications.
+*/
+static void split_range(const vector<ZZ>& coeffs, long first, long last, const ZZ& q, const ShareSink& sink) {
+    long t = (long)coeffs.size() - 1;
+
+    // Seeding: f(first), f(first+1), ..., f(first+t) with Horner's rule
+    vector<ZZ> d(t + 1);
+    ZZ x;
+    for (long i = 0; i <= t; i++) {
+        x = first + i;
+        ZZ y = coeffs[t];
+        for (long j = t - 1; j >= 0; j--) {
+            MulMod(y, y, x % q, q);
+            AddMod(y, y, coeffs[j], q);
+        }
+        d[i] = y;
+    }
+
+    // Turning the values into differences: d[j] = Δ^j f(first)
+    for (long j = 1; j <= t; j++)
+        for (long i = t; i >= j; i--)
+            SubMod(d[i], d[i], d[i - 1], q);
+
+    for (long index = first; index <= last; index++) {
+        sink(index, d[0]);
+        for (long j = 0; j < t; j++)
+            AddMod(d[j], d[j], d[j + 1], q);
+    }
+}
+
+void shamir_split_stream(const vector<ZZ>& coeffs, long n, const Group& G, const ShareSink& sink, ThreadPool* pool) {
+    if (coeffs.empty()) throw runtime_error("Polynomial needs at least the constant term!");
+    if (n <= 0) return;
+
+    long t = (long)coeffs.size() - 1;
+
+    // Every range pays O(t^2) to seed, so ranges should be much longer than t
+    long min_range = max(1024L, 16 * (t + 1));
+    long workers = pool ? (long)pool->size() * 4 : 1;
+    long range = max(min_range, (n + workers - 1) / workers);
+    long ranges = (n + range - 1) / range;
+
+    auto do_range = [&](size_t r) {
+        long first = 1 + (long)r * range;
+        long last = min(n, first + range - 1);
+        split_range(coeffs, first, last, G.q, sink);
+    };
+
+    if (pool && ranges > 1) pool->parallel_for((size_t)ranges, do_range);
+    else for (long r = 0; r < ranges; r++) do_range((size_t)r);
+}
@@ -1,6 +1,9 @@
 #pragma once // This is used to prevent the same file from being included more than once during compilation
 #include <NTL/ZZ.h>
 #include <vector>
+#include <functional>
+#include "group.h"
+#include "threadpool.h"
 
 using namespace NTL;
 using namespace std;
@@ -11,17 +14,51 @@ struct Share {
     ZZ value;     // a_i = f(i)
 };
 
-// Spliting secret into n shares with threshold t
+// Spliting secret into n shares with threshold t (shares are mod G.q)
 vector<Share> shamir_split(
     const ZZ& secret,
     long t,
     long n,
-    const ZZ& q
+    const Group& G
+);
+
+// Same, and also computing the public verification keys V_i = g^(a_i) mod p
+// (verification_keys[i-1] belongs to player i). They are published together with the shares,
+// so that anyone can check a player's partial decryptions (see proofs.h).
+vector<Share> shamir_split(
+    const ZZ& secret,
+    long t,
+    long n,
+    const Group& G,
+    vector<ZZ>& verification_keys
+);
+
+// ------------------------------------------------------------------
+// Share generation for very large committees (thousands to millions of players)
+// ------------------------------------------------------------------
+
+// Random polynomial of degree t with f(0) = secret: returns the coefficients [secret, r1, ..., rt] (mod G.q)
+vector<ZZ> shamir_random_polynomial(const ZZ& secret, long t, const Group& G);
+
+// Receives one share a_i = f(i) at a time.
+// With a thread pool it is called from several threads at once (each index exactly once),
+// so it must be thread-safe; within one index range the indices arrive in increasing order.
+typedef function<void(long index, const ZZ& value)> ShareSink;
+
+// Computing f(1), f(2), ..., f(n) and handing every share to sink instead of building a vector.
+// Uses forward differences (t additions mod q per share once seeded),
+// and splits 1..n into index ranges across the pool (nullptr = on this thread only).
+void shamir_split_stream(
+    const vector<ZZ>& coeffs,
+    long n,
+    const Group& G,
+    const ShareSink& sink,
+    ThreadPool* pool = nullptr
 );
 
 // Reconstruct secret from t+1 shares 
 // This part is for TESTING ONLY
 ZZ shamir_reconstruct(
     const vector<Share>& shares,
-    const ZZ& q
+    const Group& G
 );
@@ -0,0 +1,169 @@
+/*
+This file picks a SIMD Montgomery kernel at runtime and runs the shared-exponent
+schedule on it (see simd_mont.h). The kernels themselves are in simd_mont_*.cpp.
+*/
+
+#include "simd_mont.h"
+#include "simd_mont_kernels.h"
+#include <algorithm>
+#include <stdexcept>
+
+//-----------------------------------------------------
+//------------- Choosing a kernel ---------------------
+//-----------------------------------------------------
+
+// Whether this CPU (and OS) can run the kernel's instructions
+static bool cpu_can_run(const LaneKernel* k) {
+    if (!k) return false;
+    string name = k->name;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (name == "avx2") return __builtin_cpu_supports("avx2");
+    if (name == "avx512f") return __builtin_cpu_supports("avx512f");
+    if (name == "avx512ifma") return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512ifma");
+#endif
+    return false;
+}
+
+// Compiled kernels, fastest first
+static vector<const LaneKernel*> all_kernels() {
+    return { lane_kernel_ifma(), lane_kernel_avx512(), lane_kernel_avx2() };
+}
+
+vector<string> lane_kernels_available() {
+    vector<string> names;
+    for (const LaneKernel* k : all_kernels()) {
+        if (cpu_can_run(k)) names.push_back(k->name);
+    }
+    return names;
+}
+
+// Only IFMA is picked automatically: with 27..31-bit limbs the avx512f / avx2 kernels do about
+// 4x the multiplications of GMP's 64-bit limbs and were not faster than it at 4096 bits
+string lane_kernel_default() {
+    const LaneKernel* k = lane_kernel_ifma();
+    return cpu_can_run(k) ? k->name : "";
+}
+
+static const LaneKernel* pick_kernel(string name) {
+    if (name == "auto") name = lane_kernel_default();
+    for (const LaneKernel* k : all_kernels()) {
+        if (cpu_can_run(k) && name == k->name) return k;
+    }
+    throw runtime_error("SIMD kernel '" + name + "' is not available on this CPU/build!");
+}
+
+//-----------------------------------------------------
+//------------- Number format of the kernels ----------
+//-----------------------------------------------------
+
+// x (0 <= x < 2^(r*n)) as n limbs of r bits, written to out[0], out[stride], out[2*stride], ...
+static void to_limbs(uint64_t* out, size_t stride, const ZZ& x, size_t n, unsigned r) {
+    vector<unsigned char> buf((r * n + 7) / 8 + 8, 0);
+    BytesFromZZ(buf.data(), x, (long)buf.size());
+
+    uint64_t mask = (1ULL << r) - 1;
+    for (size_t k = 0; k < n; k++) {
+        size_t bit = r * k;
+        uint64_t v = 0;
+        for (int b = 0; b < 8; b++) v |= (uint64_t)buf[bit / 8 + b] << (8 * b);
+        out[k * stride] = (v >> (bit % 8)) & mask;
+    }
+}
+
+// Back from n limbs of r bits (read from in[0], in[stride], ...) to a ZZ
+static ZZ from_limbs(const uint64_t* in, size_t stride, size_t n, unsigned r) {
+    vector<unsigned char> buf((r * n + 7) / 8 + 8, 0);
+
+    for (size_t k = 0; k < n; k++) {
+        size_t bit = r * k;
+        uint64_t v = in[k * stride] << (bit % 8); // r <= 52, so this still fits in 64 bits
+        for (int b = 0; b < 8; b++) buf[bit / 8 + b] |= (unsigned char)(v >> (8 * b));
+    }
+
+    return ZZFromBytes(buf.data(), (long)buf.size());
+}
+
+// Limb size for the 32 x 32-bit kernels: as large as possible while a column
+// (at most 2n products below 2^(2r), plus a carry) still fits in a 64-bit lane
+static unsigned choose_radix(long pbits) {
+    for (unsigned r = 31; r >= 16; r--) {
+        long n = (pbits + 2 + r - 1) / r;
+        if (NumBits(ZZ(2 * n)) + 2 * (long)r <= 63) return r;
+    }
+    throw runtime_error("Modulus is too large for the SIMD kernels!");
+}
+
+//-----------------------------------------------------
+//------------- Shared-exponent powering --------------
+//-----------------------------------------------------
+
+vector<ZZ> lane_power_many(const vector<ZZ>& bases, const ZZ& e, const ZZ& p, const string& kernel) {
+    if (sign(e) < 0) throw runtime_error("lane_power_many: the exponent must be non-negative!");
+    if (!IsOdd(p) || p <= 1) throw runtime_error("lane_power_many: the modulus must be odd!");
+
+    const LaneKernel* k = pick_kernel(kernel);
+    vector<ZZ> results(bases.size(), ZZ(1));
+    if (bases.empty() || IsZero(e)) return results;
+
+    // Number format: n limbs of r bits with 4p < R = 2^(r*n) (so values can stay in [0, 2p))
+    long pbits = NumBits(p);
+    unsigned r = k->fixed_radix ? k->fixed_radix : choose_radix(pbits);
+    size_t n = (pbits + 2 + r - 1) / r;
+    if (k->fixed_radix && NumBits(ZZ(4 * (long)n)) + (long)r > 63)
+        throw runtime_error("Modulus is too large for the SIMD kernels!");
+
+    vector<uint64_t> p_limbs(n);
+    to_limbs(p_limbs.data(), 1, p, n, r);
+
+    ZZ two_r = ZZ(1) << (long)r;
+    ZZ n0inv = two_r - InvMod(p % two_r, two_r); // -p^(-1) mod 2^r
+
+    LaneModulus m;
+    m.limbs = n;
+    m.radix = r;
+    m.p = p_limbs.data();
+    m.n0inv = (uint64_t)conv<long>(n0inv); // < 2^52, fits in a long;
+
+    ZZ R_mod_p = (ZZ(1) << (long)(r * n)) % p;
+    ZZ R_inv = InvMod(R_mod_p, p);
+
+    // Fixed windows of w bits over the shared exponent (the same steps for every lane)
+    const long w = 4;
+    const size_t entries = 1 << w;
+    long windows = (NumBits(e) + w - 1) / w;
+    vector<size_t> digit(windows);
+    for (long j = 0; j < windows; j++) {
+        size_t d = 0;
+        for (long b = w - 1; b >= 0; b--) d = (d << 1) | bit(e, j * w + b);
+        digit[j] = d;
+    }
+
+    size_t L = k->lanes, words = n * L;
+    vector<uint64_t> table(entries * words), acc(words), scratch((2 * n + 2) * L);
+    auto entry = [&](size_t d) { return table.data() + d * words; };
+
+    for (size_t start = 0; start < bases.size(); start += L) {
+        // Entry 0 is 1 and entry 1 is the base (both in Montgomery form); unused lanes just compute 1^e
+        for (size_t lane = 0; lane < L; lane++) {
+            ZZ x = start + lane < bases.size() ? bases[start + lane] % p : ZZ(1);
+            to_limbs(entry(0) + lane, L, R_mod_p, n, r);
+            to_limbs(entry(1) + lane, L, MulMod(x, R_mod_p, p), n, r);
+        }
+        for (size_t d = 2; d < entries; d++) k->mul(m, entry(d), entry(d - 1), entry(1), scratch.data());
+
+        copy(entry(digit[windows - 1]), entry(digit[windows - 1]) + words, acc.begin());
+        for (long j = windows - 2; j >= 0; j--) {
+            for (long s = 0; s < w; s++) k->mul(m, acc.data(), acc.data(), acc.data(), scratch.data());
+            k->mul(m, acc.data(), acc.data(), entry(digit[j]), scratch.data()); // also for digit 0 (times 1)
+        }
+
+        // Leaving Montgomery form: value / R mod p (the lane value is only reduced below 2p)
+        for (size_t lane = 0; lane < L && start + lane < bases.size(); lane++) {
+            ZZ v = from_limbs(acc.data() + lane, L, n, r) % p;
+            results[start + lane] = MulMod(v, R_inv, p);
+        }
+    }
+
+    return results;
+}
@@ -0,0 +1,34 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <NTL/ZZ.h>
+#include <string>
+#include <vector>
+
+using namespace NTL;
+using namespace std;
+
+/*
+Many exponentiations with the SAME exponent, side by side in SIMD lanes:
+
+    bases[0]^e, bases[1]^e, ...  mod p
+
+This is exactly what a player does for a batch (B_j^(a_i) for many B_j). Every lane has its own
+table of powers, but all lanes follow one fixed-window schedule of the shared exponent,
+so there are no lane-dependent branches.
+
+Kernels (checked at runtime against what the CPU supports):
+    "avx512ifma"  8 lanes, 52-bit limbs with vpmadd52luq/huq
+    "avx512f"     8 lanes, 27..31-bit limbs with vpmuludq
+    "avx2"        4 lanes, 27..31-bit limbs with vpmuludq
+*/
+
+// Names of the kernels this build and this CPU can run, fastest first (empty if none)
+vector<string> lane_kernels_available();
+
+// The kernel "auto" stands for: "avx512ifma" if the CPU has it, otherwise "" (none,
+// because the 32-bit multiplier kernels are not faster than plain GMP PowerMod)
+string lane_kernel_default();
+
+// bases[j]^e mod p for every j (p odd, e >= 0).
+// kernel = "auto" (see above) or a name from lane_kernels_available().
+// Throws if the kernel cannot run here.
+vector<ZZ> lane_power_many(const vector<ZZ>& bases, const ZZ& e, const ZZ& p, const string& kernel = "auto");
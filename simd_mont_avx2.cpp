@@ -0,0 +1,62 @@
+/*
+Lane-parallel Montgomery multiplication with AVX2: 4 numbers at once.
+Limbs of r <= 31 bits sit in 64-bit lanes and are multiplied with vpmuludq (32 x 32 -> 64 bits).
+Carries are not propagated inside the loop: a column collects at most 2n products
+below 2^(2r), and the caller picks r so that this still fits in 64 bits.
+*/
+
+#include "simd_mont_kernels.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+static void mul_avx2(const LaneModulus& m, uint64_t* out, const uint64_t* a, const uint64_t* b, uint64_t* t) {
+    const size_t n = m.limbs;
+    const __m256i mask = _mm256_set1_epi64x((long long)((1ULL << m.radix) - 1));
+    const __m128i shift = _mm_cvtsi32_si128((int)m.radix);
+    const __m256i n0 = _mm256_set1_epi64x((long long)m.n0inv);
+
+    __m256i* T = (__m256i*)t;
+    const __m256i* A = (const __m256i*)a;
+    const __m256i* Bv = (const __m256i*)b;
+    for (size_t k = 0; k < 2 * n + 2; k++) _mm256_storeu_si256(T + k, _mm256_setzero_si256());
+
+    for (size_t i = 0; i < n; i++) {
+        __m256i bi = _mm256_loadu_si256(Bv + i);
+
+        // Column i is complete after a_0 * b_i, so the Montgomery factor m_i can be chosen now
+        __m256i ti = _mm256_add_epi64(_mm256_loadu_si256(T + i), _mm256_mul_epu32(_mm256_loadu_si256(A), bi));
+        __m256i mi = _mm256_and_si256(_mm256_mul_epu32(ti, n0), mask);
+        ti = _mm256_add_epi64(ti, _mm256_mul_epu32(_mm256_set1_epi64x((long long)m.p[0]), mi));
+
+        // Column i is now a multiple of 2^r: its carry moves to column i+1
+        __m256i carry = _mm256_srl_epi64(ti, shift);
+        _mm256_storeu_si256(T + i + 1, _mm256_add_epi64(_mm256_loadu_si256(T + i + 1), carry));
+
+        for (size_t j = 1; j < n; j++) {
+            __m256i x = _mm256_loadu_si256(T + i + j);
+            x = _mm256_add_epi64(x, _mm256_mul_epu32(_mm256_loadu_si256(A + j), bi));
+            x = _mm256_add_epi64(x, _mm256_mul_epu32(_mm256_set1_epi64x((long long)m.p[j]), mi));
+            _mm256_storeu_si256(T + i + j, x);
+        }
+    }
+
+    // The result is columns n .. 2n-1 divided by R; bringing every limb back below 2^r
+    __m256i c = _mm256_setzero_si256();
+    __m256i* O = (__m256i*)out;
+    for (size_t k = 0; k < n; k++) {
+        __m256i v = _mm256_add_epi64(_mm256_loadu_si256(T + n + k), c);
+        _mm256_storeu_si256(O + k, _mm256_and_si256(v, mask));
+        c = _mm256_srl_epi64(v, shift);
+    }
+}
+
+static const LaneKernel AVX2_KERNEL = { "avx2", 4, 0, mul_avx2 };
+
+const LaneKernel* lane_kernel_avx2() { return &AVX2_KERNEL; }
+
+#else
+
+const LaneKernel* lane_kernel_avx2() { return nullptr; }
+
+#endif
@@ -0,0 +1,56 @@
+/*
+Lane-parallel Montgomery multiplication with AVX-512F: 8 numbers at once.
+Same method as the AVX2 kernel (r <= 31 bit limbs, vpmuludq, lazy carries), twice as wide.
+*/
+
+#include "simd_mont_kernels.h"
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+
+static void mul_avx512(const LaneModulus& m, uint64_t* out, const uint64_t* a, const uint64_t* b, uint64_t* t) {
+    const size_t n = m.limbs;
+    const __m512i mask = _mm512_set1_epi64((long long)((1ULL << m.radix) - 1));
+    const __m128i shift = _mm_cvtsi32_si128((int)m.radix);
+    const __m512i n0 = _mm512_set1_epi64((long long)m.n0inv);
+
+    for (size_t k = 0; k < 2 * n + 2; k++) _mm512_storeu_si512(t + 8 * k, _mm512_setzero_si512());
+
+    for (size_t i = 0; i < n; i++) {
+        __m512i bi = _mm512_loadu_si512(b + 8 * i);
+
+        // Column i is complete after a_0 * b_i, so the Montgomery factor m_i can be chosen now
+        __m512i ti = _mm512_add_epi64(_mm512_loadu_si512(t + 8 * i), _mm512_mul_epu32(_mm512_loadu_si512(a), bi));
+        __m512i mi = _mm512_and_si512(_mm512_mul_epu32(ti, n0), mask);
+        ti = _mm512_add_epi64(ti, _mm512_mul_epu32(_mm512_set1_epi64((long long)m.p[0]), mi));
+
+        // Column i is now a multiple of 2^r: its carry moves to column i+1
+        __m512i carry = _mm512_srl_epi64(ti, shift);
+        _mm512_storeu_si512(t + 8 * (i + 1), _mm512_add_epi64(_mm512_loadu_si512(t + 8 * (i + 1)), carry));
+
+        for (size_t j = 1; j < n; j++) {
+            __m512i x = _mm512_loadu_si512(t + 8 * (i + j));
+            x = _mm512_add_epi64(x, _mm512_mul_epu32(_mm512_loadu_si512(a + 8 * j), bi));
+            x = _mm512_add_epi64(x, _mm512_mul_epu32(_mm512_set1_epi64((long long)m.p[j]), mi));
+            _mm512_storeu_si512(t + 8 * (i + j), x);
+        }
+    }
+
+    // The result is columns n .. 2n-1 divided by R; bringing every limb back below 2^r
+    __m512i c = _mm512_setzero_si512();
+    for (size_t k = 0; k < n; k++) {
+        __m512i v = _mm512_add_epi64(_mm512_loadu_si512(t + 8 * (n + k)), c);
+        _mm512_storeu_si512(out + 8 * k, _mm512_and_si512(v, mask));
+        c = _mm512_srl_epi64(v, shift);
+    }
+}
+
+static const LaneKernel AVX512_KERNEL = { "avx512f", 8, 0, mul_avx512 };
+
+const LaneKernel* lane_kernel_avx512() { return &AVX512_KERNEL; }
+
+#else
+
+const LaneKernel* lane_kernel_avx512() { return nullptr; }
+
+#endif
@@ -0,0 +1,69 @@
+/*
+Lane-parallel Montgomery multiplication with AVX-512 IFMA: 8 numbers at once, 52-bit limbs.
+vpmadd52luq / vpmadd52huq add the low / high 52 bits of a 52 x 52-bit product to a 64-bit lane,
+so a product of two limbs goes to its column (low half) and to the next column (high half).
+*/
+
+#include "simd_mont_kernels.h"
+
+#if defined(__AVX512F__) && defined(__AVX512IFMA__)
+#include <immintrin.h>
+
+static void mul_ifma(const LaneModulus& m, uint64_t* out, const uint64_t* a, const uint64_t* b, uint64_t* t) {
+    const size_t n = m.limbs;
+    const __m512i mask = _mm512_set1_epi64((long long)((1ULL << 52) - 1));
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i n0 = _mm512_set1_epi64((long long)m.n0inv);
+
+    for (size_t k = 0; k < 2 * n + 2; k++) _mm512_storeu_si512(t + 8 * k, zero);
+
+    const __m512i a0 = _mm512_loadu_si512(a);
+    const __m512i p0 = _mm512_set1_epi64((long long)m.p[0]);
+
+    for (size_t i = 0; i < n; i++) {
+        __m512i bi = _mm512_loadu_si512(b + 8 * i);
+
+        // Column i is complete after the low half of a_0 * b_i: choosing m_i (low 52 bits of t_i * n0inv)
+        __m512i ti = _mm512_madd52lo_epu64(_mm512_loadu_si512(t + 8 * i), a0, bi);
+        __m512i mi = _mm512_madd52lo_epu64(zero, ti, n0);
+        ti = _mm512_madd52lo_epu64(ti, p0, mi);
+
+        // h = what goes into the next column: the carry of column i and the high halves of the products
+        __m512i h = _mm512_srli_epi64(ti, 52);
+        h = _mm512_madd52hi_epu64(h, a0, bi);
+        h = _mm512_madd52hi_epu64(h, p0, mi);
+
+        for (size_t j = 1; j < n; j++) {
+            __m512i aj = _mm512_loadu_si512(a + 8 * j);
+            __m512i pj = _mm512_set1_epi64((long long)m.p[j]);
+
+            __m512i x = _mm512_add_epi64(_mm512_loadu_si512(t + 8 * (i + j)), h);
+            x = _mm512_madd52lo_epu64(x, aj, bi);
+            x = _mm512_madd52lo_epu64(x, pj, mi);
+            _mm512_storeu_si512(t + 8 * (i + j), x);
+
+            h = _mm512_madd52hi_epu64(zero, aj, bi);
+            h = _mm512_madd52hi_epu64(h, pj, mi);
+        }
+
+        _mm512_storeu_si512(t + 8 * (i + n), _mm512_add_epi64(_mm512_loadu_si512(t + 8 * (i + n)), h));
+    }
+
+    // The result is columns n .. 2n-1 divided by R; bringing every limb back below 2^52
+    __m512i c = zero;
+    for (size_t k = 0; k < n; k++) {
+        __m512i v = _mm512_add_epi64(_mm512_loadu_si512(t + 8 * (n + k)), c);
+        _mm512_storeu_si512(out + 8 * k, _mm512_and_si512(v, mask));
+        c = _mm512_srli_epi64(v, 52);
+    }
+}
+
+static const LaneKernel IFMA_KERNEL = { "avx512ifma", 8, 52, mul_ifma };
+
+const LaneKernel* lane_kernel_ifma() { return &IFMA_KERNEL; }
+
+#else
+
+const LaneKernel* lane_kernel_ifma() { return nullptr; }
+
+#endif
@@ -0,0 +1,42 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <cstddef>
+#include <cstdint>
+
+/*
+Plain data shared between simd_mont.cpp and the SIMD kernels.
+
+The kernel files (simd_mont_avx2.cpp, simd_mont_avx512.cpp, simd_mont_ifma.cpp) are compiled
+with extra instruction sets, so they include nothing but this header and <immintrin.h>
+(no NTL, no standard library templates that could get mixed up with the normal build).
+*/
+
+// The modulus p in the kernels' number format
+struct LaneModulus {
+    size_t limbs;        // n: every number has n limbs
+    unsigned radix;      // r: every limb holds r bits (R = 2^(r*n) and 4p < R)
+    const uint64_t* p;   // the n limbs of p
+    uint64_t n0inv;      // -p^(-1) mod 2^r
+};
+
+/*
+A Montgomery multiplier working on several independent numbers at once, one per SIMD lane.
+Numbers are stored limb by limb: x[limb * lanes + lane], and every limb is < 2^r.
+
+    mul(m, out, a, b, t):  out = a * b / R mod p  in every lane
+
+Inputs and output are only reduced to [0, 2p) (enough because 4p < R), so no final
+subtraction (and no lane-dependent branch) is ever needed.
+t is scratch space of (2n + 2) * lanes words. out may be the same array as a or b.
+*/
+struct LaneKernel {
+    const char* name;
+    size_t lanes;
+    unsigned fixed_radix; // 52 for IFMA; 0 = the caller picks a radix <= 31 (32x32-bit multipliers)
+    void (*mul)(const LaneModulus& m, uint64_t* out, const uint64_t* a, const uint64_t* b, uint64_t* t);
+};
+
+// Each returns nullptr if the file was not compiled for its instruction set (for example not on x86-64).
+// Whether the CPU can run it is checked separately (see simd_mont.cpp).
+const LaneKernel* lane_kernel_avx2();
+const LaneKernel* lane_kernel_avx512();
+const LaneKernel* lane_kernel_ifma();
@@ -0,0 +1,49 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <NTL/ZZ.h>
+#include <vector>
+#include "group.h"
+
+using namespace NTL;
+using namespace std;
+
+/*
+Checking that ciphertext values B are in the subgroup of order q BEFORE a player raises them
+to its share: B^(a_i) for a B with a small-order part would leak a_i modulo that order.
+
+Exact check for one element: 0 < B < p, Jacobi(B, p) == 1 and B^q == 1 (one exponentiation).
+
+Batched check (small-exponent random linear combination), for B_1 .. B_n:
+
+    X = B_1^δ_1 * B_2^δ_2 * ... * B_n^δ_n    (random 32-bit δ_j: one short multi-exponentiation)
+    X^q == 1                                  (one full exponentiation for the whole batch)
+
+If every B_j is in the subgroup this always passes. A bad B_j has B_j^q != 1, an element of the
+group of order (p-1)/q, and the Jacobi check leaves only its part in the group of order
+(p-1)/(2q). One round misses it with probability about 1/ℓ, where ℓ is the smallest prime
+factor of (p-1)/(2q) (Group::cofactor_prime). So the number of rounds depends on the group:
+
+    safe prime, (p-1)/(2q) == 1     the Jacobi check alone is exact, no exponentiation at all
+    no prime factor below 2^16      security_bits / 16 rounds
+    small factors (ℓ = 2, 3, ...)   security_bits / log2(ℓ) rounds: with ℓ = 2 (like the built-in
+                                    4093-bit group) batching is NOT cheaper than exact checks, and
+                                    find_non_subgroup just does exact checks (in SIMD lanes)
+
+On a prime-order curve every encoded point is in the group, so only the decoding is checked.
+*/
+
+// Default: a bad element slips through a batch with probability about 2^-64
+const long SUBGROUP_SECURITY_BITS = 64;
+
+// Exact check of one element
+bool in_subgroup(const ZZ& x, const Group& G);
+
+// Rounds of the batch test for this group (0 = the cheap checks are already exact)
+long subgroup_batch_rounds(const Group& G, long security_bits = SUBGROUP_SECURITY_BITS);
+
+// Batch test: true if (with the error above) every element is in the subgroup
+bool subgroup_check_batch(const vector<ZZ>& xs, const Group& G, long security_bits = SUBGROUP_SECURITY_BITS);
+
+// Positions of the elements that are NOT in the subgroup (sorted, empty if all are fine).
+// Batch test first; only when a batch fails it is cut in halves until the bad elements are found.
+// Batches too small for batching to pay off get exact checks.
+vector<size_t> find_non_subgroup(const vector<ZZ>& xs, const Group& G, long security_bits = SUBGROUP_SECURITY_BITS);
@@ -0,0 +1,120 @@
+/*
+This file implements the work-stealing thread pool used by the batch APIs.
+Each worker pops tasks from the back of its own queue (most recently pushed),
+and when that is empty it steals from the front of the other queues.
+*/
+
+#include "threadpool.h"
+#include <exception>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+
+    queues = vector<Queue>(threads);
+    for (unsigned i = 0; i < threads; i++)
+        workers.emplace_back(&ThreadPool::worker_loop, this, (size_t)i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lk(sleep_m);
+        stopping = true;
+    }
+    sleep_cv.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+void ThreadPool::push(size_t queue, function<void()> task) {
+    {
+        lock_guard<mutex> lk(sleep_m);
+        pending++; // counted before it is visible, so a sleeping worker never misses it
+    }
+    {
+        lock_guard<mutex> lk(queues[queue].m);
+        queues[queue].tasks.push_back(move(task));
+    }
+    sleep_cv.notify_one();
+}
+
+bool ThreadPool::try_pop(size_t self, function<void()>& task) {
+    size_t n = queues.size();
+
+    // First our own queue (newest task), then stealing from the others (oldest task)
+    for (size_t k = 0; k < n; k++) {
+        Queue& qu = queues[(self + k) % n];
+        lock_guard<mutex> lk(qu.m);
+        if (qu.tasks.empty()) continue;
+
+        if (k == 0) { task = move(qu.tasks.back()); qu.tasks.pop_back(); }
+        else        { task = move(qu.tasks.front()); qu.tasks.pop_front(); }
+        pending--;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::worker_loop(size_t self) {
+    function<void()> task;
+    while (true) {
+        if (try_pop(self, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        unique_lock<mutex> lk(sleep_m);
+        sleep_cv.wait(lk, [&] { return stopping || pending > 0; });
+        if (stopping && pending <= 0) return;
+    }
+}
+
+void ThreadPool::parallel_for(size_t n, const function<void(size_t)>& body) {
+    if (n == 0) return;
+
+    // Shared state of this call: how many chunks are left and the first error
+    struct State {
+        atomic<size_t> remaining{0};
+        mutex m;
+        condition_variable done_cv;
+        exception_ptr error;
+    };
+    auto st = make_shared<State>();
+
+    // Several chunks per worker, so that stealing can even out uneven work
+    size_t chunks = min(n, (size_t)size() * 4);
+    size_t per_chunk = (n + chunks - 1) / chunks;
+    chunks = (n + per_chunk - 1) / per_chunk;
+    st->remaining = chunks;
+
+    for (size_t c = 0; c < chunks; c++) {
+        size_t begin = c * per_chunk;
+        size_t end = min(n, begin + per_chunk);
+
+        push(c % queues.size(), [st, begin, end, &body] {
+            try {
+                for (size_t i = begin; i < end; i++) body(i);
+            } catch (...) {
+                lock_guard<mutex> lk(st->m);
+                if (!st->error) st->error = current_exception();
+            }
+            if (--st->remaining == 0) {
+                lock_guard<mutex> lk(st->m);
+                st->done_cv.notify_all();
+            }
+        });
+    }
+
+    // The calling thread helps until no queued task is left, then waits for the running ones
+    function<void()> task;
+    while (st->remaining > 0 && try_pop(0, task)) {
+        task();
+        task = nullptr;
+    }
+
+    unique_lock<mutex> lk(st->m);
+    st->done_cv.wait(lk, [&] { return st->remaining == 0; });
+
+    if (st->error) rethrow_exception(st->error);
+}
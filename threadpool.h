@@ -0,0 +1,48 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// A small work-stealing thread pool.
+// Every worker has its own task queue; an idle worker steals from the other queues,
+// so one slow task does not leave the other cores waiting.
+class ThreadPool {
+public:
+    // threads = 0 means "one worker per hardware thread"
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return (unsigned)workers.size(); }
+
+    // Runs body(i) for every i in [0, n) on the pool and waits until all are done.
+    // The calling thread helps with the work while it waits.
+    // If a body throws, the first exception is rethrown here after all tasks finished.
+    void parallel_for(size_t n, const function<void(size_t)>& body);
+
+private:
+    struct Queue {
+        mutex m;
+        deque<function<void()>> tasks;
+    };
+
+    vector<thread> workers;
+    vector<Queue> queues;
+
+    mutex sleep_m;
+    condition_variable sleep_cv;
+    atomic<long> pending{0}; // number of queued (not yet started) tasks
+    bool stopping = false;
+
+    void push(size_t queue, function<void()> task);
+    bool try_pop(size_t self, function<void()>& task);
+    void worker_loop(size_t self);
+};
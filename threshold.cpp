@@ -1,4 +1,9 @@
 #include "threshold.h"
+#include "multiexp.h"
+#include "simd_mont.h"
+#include "metrics.h"
+#include <algorithm>
+#include <stdexcept>
 
 // A player's partial decryption is being computed here using their secret share
 
@@ -7,10 +12,44 @@
 	
 	** B is the first part of ElGamal ciphertext (created during encryption)
 	** share_ai is player i’s share of the secret key
-	** p is the prime modulus
+	** G is the group (numbers mod G.p, or an elliptic curve)
 */
-ZZ partial_decrypt(const ZZ& B, const ZZ& share_ai, const ZZ& p) {
-    return PowerMod(B, share_ai, p); // Computing partial decryption, D_i = B^(a_i) mod p
+ZZ partial_decrypt(const ZZ& B, const ZZ& share_ai, const Group& G) {
+    TE_TIME(T_PARTIAL_DECRYPT);
+
+    // Computing partial decryption, D_i = B^(a_i) mod p
+    // (on the fixed-width Montgomery backend when the group has one, or on the curve)
+    return group_power(G, B, share_ai);
+}
+
+// Same as above, written into out (no new ZZ per call)
+void partial_decrypt(ZZ& out, const ZZ& B, const ZZ& share_ai, const Group& G) {
+    TE_TIME(T_PARTIAL_DECRYPT);
+    group_power(out, G, B, share_ai);
+}
+
+/*
+	Partial decryptions of a whole batch by one player (same share, many B's).
+	
+	Every B_j is raised to the same exponent a_i, so all of them can follow one
+	exponentiation schedule in parallel SIMD lanes. The scalar loop is used for curve
+	groups, for a single ciphertext, or when the CPU has no suitable kernel.
+*/
+vector<ZZ> partial_decrypt_many(const vector<ZZ>& Bs, const ZZ& share_ai, const Group& G, const string& kernel) {
+    TE_TIME(T_PARTIAL_DECRYPT_MANY);
+
+    string k = kernel == "auto" ? lane_kernel_default() : kernel;
+    bool scalar = G.curve || k.empty() || k == "scalar" || sign(share_ai) < 0 || (kernel == "auto" && Bs.size() < 2);
+
+    if (scalar) {
+        vector<ZZ> D(Bs.size());
+        for (size_t j = 0; j < Bs.size(); j++) D[j] = partial_decrypt(Bs[j], share_ai, G);
+        return D;
+    }
+
+    TE_COUNT(M_MODEXP, Bs.size()); // the scalar path above counts in group_power
+    TE_COUNT(M_MODEXP_BITS, Bs.size() * NumBits(share_ai));
+    return lane_power_many(Bs, share_ai, G.p, k);
 }
 
 /*
@@ -18,14 +57,19 @@ ZZ partial_decrypt(const ZZ& B, const ZZ& share_ai, const ZZ& p) {
 	
 	** partials = list of partial decryptions: [D_1, D_2, D_3, ...]
 	** weights = list of Lagrange weights: [λ_1, λ_2, λ_3, ...]
-	** p = modulus
+	** G = group (G.p is the modulus)
 */
-ZZ combine_partials(const vector<ZZ>& partials, const vector<ZZ>& weights, const ZZ& p) {
+ZZ combine_partials(const vector<ZZ>& partials, const vector<ZZ>& weights, const Group& G) {
+    TE_TIME(T_COMBINE);
+    if (G.curve) return G.curve->multi_power(partials, weights); // a curve has no separate reference path
+
     ZZ result(1);
 
     for (size_t i = 0; i < partials.size(); i++) {
-        ZZ term = PowerMod(partials[i], weights[i], p);
-        result = MulMod(result, term, p);
+        ZZ term = PowerMod(partials[i], weights[i], G.p);
+        TE_COUNT(M_MODEXP, 1);
+        TE_COUNT(M_MODEXP_BITS, NumBits(weights[i]));
+        result = MulMod(result, term, G.p);
 		// We combine the result by multiplying the partial decryptions
 		// because multiplication adds exponents and reconstructs the correct power
 		// without rebuilding the secret key
@@ -33,3 +77,108 @@ ZZ combine_partials(const vector<ZZ>& partials, const vector<ZZ>& weights, const
 
     return result;
 }
+
+/*
+	Faster version of combine_partials:
+	
+	** S = D_1^λ_1 * D_2^λ_2 * ... is computed as a single multi-exponentiation
+	** all players share the same squarings, instead of k separate PowerMod calls
+*/
+ZZ combine_partials_multiexp(const vector<ZZ>& partials, const vector<ZZ>& weights, const Group& G) {
+    TE_TIME(T_COMBINE);
+    if (partials.size() != weights.size())
+        throw runtime_error("Number of partials and weights must match!");
+
+    // Straus on the fixed-width backend, Pippenger (NTL) for very large committees, or the curve
+    return group_multi_power(G, partials, weights);
+}
+
+// Same as above, written into out, with the Straus table kept in the workspace
+void combine_partials_multiexp(ZZ& out, const vector<ZZ>& partials, const vector<ZZ>& weights,
+                               const Group& G, Workspace& ws) {
+    TE_TIME(T_COMBINE);
+    if (partials.size() != weights.size())
+        throw runtime_error("Number of partials and weights must match!");
+
+    group_multi_power(out, G, partials, weights, ws.limbs());
+}
+
+
+// ------------------------------
+// Tagged partials
+// ------------------------------
+
+Partial partial_decrypt_tagged(const ZZ& B, const Share& share, const Group& G) {
+    Partial d;
+    d.index = share.index;
+    d.mode = PARTIAL_RAW;
+    d.value = partial_decrypt(B, share.value, G);
+    return d;
+}
+
+/*
+	Pre-weighted partial decryption:
+	
+	** the combiner would compute D_i^(λ_i) = B^(a_i * λ_i) anyway
+	** so the player multiplies λ_i * a_i mod q first (cheap) and does one exponentiation
+	** the combiner is then left with a plain product of the D_i
+*/
+Partial partial_decrypt_weighted(const ZZ& B, const Share& share, const vector<long>& subset,
+                                 const Group& G, LagrangeCache* cache) {
+    vector<long> sorted_subset(subset);
+    sort(sorted_subset.begin(), sorted_subset.end());
+
+    auto pos = lower_bound(sorted_subset.begin(), sorted_subset.end(), share.index);
+    if (pos == sorted_subset.end() || *pos != share.index)
+        throw runtime_error("Player " + to_string(share.index) + " is not in the decryption committee!");
+
+    // Weights of the sorted committee (the cache stores them in this order as well)
+    vector<ZZ> weights = cache ? cache->weights(sorted_subset) : lagrange_weights_at_zero(sorted_subset, G);
+    const ZZ& lambda = weights[pos - sorted_subset.begin()];
+
+    Partial d;
+    d.index = share.index;
+    d.mode = PARTIAL_WEIGHTED;
+    d.value = partial_decrypt(B, MulMod(lambda, share.value, G.q), G); // B^(λ_i * a_i mod q), since B has order q
+    d.subset = sorted_subset;
+    return d;
+}
+
+ZZ combine_partials(const vector<Partial>& partials, const Group& G) {
+    if (partials.empty()) throw runtime_error("No partial decryptions to combine!");
+
+    PartialMode mode = partials[0].mode;
+    for (auto& d : partials) {
+        if (d.mode != mode) throw runtime_error("Cannot combine raw and pre-weighted partials together!");
+    }
+
+    if (mode == PARTIAL_RAW) {
+        vector<long> idx;
+        vector<ZZ> values;
+        for (auto& d : partials) {
+            idx.push_back(d.index);
+            values.push_back(d.value);
+        }
+        return combine_partials_multiexp(values, lagrange_weights_at_zero(idx, G), G);
+    }
+
+    // Pre-weighted: the weights only add up to the secret if exactly the committee
+    // they were computed for shows up, each player once
+    const vector<long>& committee = partials[0].subset;
+    vector<long> idx;
+    for (auto& d : partials) {
+        if (d.subset != committee)
+            throw runtime_error("Pre-weighted partials were computed for different committees!");
+        idx.push_back(d.index);
+    }
+    sort(idx.begin(), idx.end());
+    if (idx != committee)
+        throw runtime_error("Pre-weighted partials do not match their committee!");
+
+    TE_TIME(T_COMBINE);
+    ZZ result = partials[0].value;
+    for (size_t i = 1; i < partials.size(); i++)
+        result = group_mul(G, result, partials[i].value);
+
+    return result;
+}
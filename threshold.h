@@ -1,12 +1,74 @@
 #pragma once // This is used to prevent the same file from being included more than once during compilation
 #include <NTL/ZZ.h>
+#include <string>
 #include <vector>
+#include "group.h"
+#include "shamir.h"
+#include "lagrange.h"
+#include "workspace.h"
 
 using namespace NTL;
 using namespace std;
 
+// A full hybrid ciphertext: the ElGamal part B = g^b and the AES-256-GCM data (nonce || ciphertext || tag)
+struct Ciphertext {
+    ZZ B;
+    vector<unsigned char> aead;
+};
+
 // A player's partial decryption is being computed here using their secret share
-ZZ partial_decrypt(const ZZ& B, const ZZ& share_ai, const ZZ& p);
+ZZ partial_decrypt(const ZZ& B, const ZZ& share_ai, const Group& G);
+
+// The same player's partial decryptions of many ciphertexts: Bs[j]^(a_i) for every j.
+// On the prime-field group the exponentiations run side by side in SIMD lanes (see simd_mont.h);
+// kernel = "auto", "scalar" (one partial_decrypt per ciphertext) or a SIMD kernel name.
+// The Bs are used as given: check them first with find_non_subgroup (subgroup.h).
+vector<ZZ> partial_decrypt_many(const vector<ZZ>& Bs, const ZZ& share_ai, const Group& G, const string& kernel = "auto");
 
 // The following function combines all the partial values
-ZZ combine_partials(const vector<ZZ>& partials, const vector<ZZ>& weights, const ZZ& p);
+// (reference implementation: one PowerMod per player)
+ZZ combine_partials(const vector<ZZ>& partials, const vector<ZZ>& weights, const Group& G);
+
+// Same result as combine_partials, but computed with one multi-exponentiation (shared squarings)
+ZZ combine_partials_multiexp(const vector<ZZ>& partials, const vector<ZZ>& weights, const Group& G);
+
+// Allocation-free forms for hot loops (see workspace.h): the result is written into out,
+// whose memory is reused, and combining keeps its table in the workspace
+void partial_decrypt(ZZ& out, const ZZ& B, const ZZ& share_ai, const Group& G);
+void combine_partials_multiexp(ZZ& out, const vector<ZZ>& partials, const vector<ZZ>& weights,
+                               const Group& G, Workspace& ws);
+
+
+// ------------------------------
+// Tagged partials (raw or pre-weighted)
+// ------------------------------
+
+// How the value of a Partial was computed
+enum PartialMode {
+    PARTIAL_RAW = 0,       // D_i = B^(a_i), the combiner still applies λ_i
+    PARTIAL_WEIGHTED = 1   // D_i = B^(λ_i * a_i) for a committee fixed in advance, the combiner only multiplies
+};
+
+// A partial decryption together with who made it and how
+struct Partial {
+    long index;            // player index i
+    PartialMode mode;
+    ZZ value;
+    vector<long> subset;   // sorted committee the weight was computed for (PARTIAL_WEIGHTED only)
+};
+
+// Plain partial decryption with its tag: D_i = B^(a_i) mod p
+Partial partial_decrypt_tagged(const ZZ& B, const Share& share, const Group& G);
+
+// Pre-weighted partial decryption when the committee is known ahead of time: D_i = B^(λ_i * a_i) mod p.
+// The player folds its own Lagrange weight into the exponent, so the same single exponentiation
+// also does the combiner's work. subset must contain share.index. The cache (optional) avoids
+// recomputing λ_i for every ciphertext.
+Partial partial_decrypt_weighted(const ZZ& B, const Share& share, const vector<long>& subset,
+                                 const Group& G, LagrangeCache* cache = nullptr);
+
+// Combining tagged partials. The mode is taken from the tags:
+//   all PARTIAL_WEIGHTED -> S = D_1 * D_2 * ... (k-1 MulMods, after checking everyone used the same committee)
+//   all PARTIAL_RAW      -> Lagrange weights from the indices, then combine_partials_multiexp
+// Mixing both modes is an error.
+ZZ combine_partials(const vector<Partial>& partials, const Group& G);
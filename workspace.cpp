@@ -0,0 +1,74 @@
+/*
+This file implements the per-thread scratch space of the hot path (see workspace.h).
+*/
+
+#include "workspace.h"
+#include "metrics.h"
+#include <openssl/crypto.h> // OPENSSL_cleanse (a memset that the compiler cannot drop)
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+Workspace::Workspace(const Group& G) : p(G.p) {
+    // A product of two numbers mod p (before reduction) has twice as many limbs as p
+    long bits = NumBits(G.p);
+    capacity = 2 * ((bits + NTL_ZZ_NBITS - 1) / NTL_ZZ_NBITS) + 2;
+    wipe_limbs.assign(capacity, 0);
+    numbers(8);
+    byte_buf.resize(2 * NumBytes(G.p) + 8);
+
+    md = EVP_MD_fetch(nullptr, "SHA256", nullptr);
+    md_ctx = EVP_MD_CTX_new();
+    if (!md || !md_ctx) {
+        EVP_MD_free(md);
+        EVP_MD_CTX_free(md_ctx);
+        throw runtime_error("Workspace: could not set up SHA-256!!");
+    }
+}
+
+Workspace::~Workspace() {
+    reset();
+    EVP_MD_CTX_free(md_ctx);
+    EVP_MD_free(md);
+}
+
+ZZ* Workspace::numbers(size_t count) {
+    if (nums.size() < count) {
+        TE_COUNT(M_WORKSPACE_GROWS, 1);
+        size_t old = nums.size();
+        nums.resize(count);
+        for (size_t i = old; i < count; i++) nums[i].SetSize(capacity);
+    }
+    return nums.data();
+}
+
+unsigned char* Workspace::bytes(size_t n) {
+    if (byte_buf.size() < n) {
+        TE_COUNT(M_WORKSPACE_GROWS, 1);
+        byte_buf.resize(n);
+    }
+    return byte_buf.data();
+}
+
+void Workspace::reset() {
+    // ZZ_limbs_set drops high zero limbs before copying, so all-zero limbs would only set x = 0
+    // and leave the old limbs in memory. Zeros with a 1 on top are copied over all MaxAlloc()
+    // limbs (without reallocating), then x is set to 0.
+    for (ZZ& x : nums) {
+        long n = x.MaxAlloc();
+        if (n <= 0) continue;
+        if ((long)wipe_limbs.size() < n) wipe_limbs.assign(n, 0);
+        fill(wipe_limbs.begin(), wipe_limbs.end(), 0);
+        wipe_limbs[n - 1] = 1;
+        ZZ_limbs_set(x, wipe_limbs.data(), n);
+        clear(x);
+    }
+    if (!byte_buf.empty()) OPENSSL_cleanse(byte_buf.data(), byte_buf.size());
+    if (!limb_buf.empty()) OPENSSL_cleanse(limb_buf.data(), limb_buf.size() * sizeof(mp_limb_t));
+}
+
+Workspace& Workspace::for_thread(const Group& G) {
+    thread_local unique_ptr<Workspace> ws;
+    if (!ws || ws->p != G.p) ws.reset(new Workspace(G));
+    return *ws;
+}
@@ -0,0 +1,61 @@
+#pragma once // This is used to prevent the same file from being included more than once during compilation
+#include <NTL/ZZ.h>
+#include <vector>
+#include <openssl/evp.h>
+#include "group.h"
+
+using namespace NTL;
+using namespace std;
+
+/*
+Scratch memory for the hot path (partial decryption, combining, Lagrange weights, key hashing).
+
+The normal functions create their temporaries (ZZ, vector<ZZ>, byte vectors) on every call,
+and with many threads decrypting at once the heap becomes a point of contention.
+A Workspace keeps those temporaries alive between calls: the numbers are created once with
+room for a product of two numbers mod p, and the buffers only ever grow. After the first
+few calls with a given committee size, the functions that take a Workspace do not allocate.
+
+** one Workspace per thread (it is not safe to share one between threads), see for_thread()
+** reset() overwrites every limb of the numbers (with zeros and a 1 in the top limb, then sets
+   them to 0) and the buffers with zeros, but keeps the memory, so shares and shared secrets
+   do not stay behind in the scratch space; the destructor does the same
+*/
+class Workspace {
+public:
+    explicit Workspace(const Group& G);
+    ~Workspace();
+
+    Workspace(const Workspace&) = delete;
+    Workspace& operator=(const Workspace&) = delete;
+
+    // count scratch numbers. Pointers stay valid until a call asks for MORE numbers than before.
+    ZZ* numbers(size_t count);
+
+    // A byte buffer of at least n bytes (for encodings of numbers)
+    unsigned char* bytes(size_t n);
+
+    // Limb scratch for the Montgomery backend's multi-exponentiation table
+    vector<mp_limb_t>& limbs() { return limb_buf; }
+
+    // A SHA-256 context and digest kept for the whole life of the workspace
+    // (one-shot SHA256() looks the algorithm up and creates a context on every call)
+    EVP_MD_CTX* sha256_ctx() { return md_ctx; }
+    const EVP_MD* sha256() const { return md; }
+
+    // Zeroizing all numbers and buffers (the memory is kept for the next calls)
+    void reset();
+
+    // The calling thread's workspace for G (created on first use, or again when the group changes)
+    static Workspace& for_thread(const Group& G);
+
+private:
+    ZZ p;               // which group this workspace was sized for
+    long capacity;      // limbs reserved in every number
+    vector<ZZ> nums;
+    vector<unsigned char> byte_buf;
+    vector<mp_limb_t> limb_buf;
+    vector<ZZ_limb_t> wipe_limbs; // zeros with a 1 on top, copied over a number to wipe it
+    EVP_MD* md = nullptr;
+    EVP_MD_CTX* md_ctx = nullptr;
+};